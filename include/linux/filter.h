@@ -1197,6 +1197,13 @@ struct bpf_sock_ops_kern {
 		u32 replylong[4];
 	};
 	u32	is_fullsock;
+	struct	sock *meta_sk;		/* MPTCP context, see
+					 * mptcp_init_sock_ops
+					 */
+	u8	mptcp_path_index;
+	u8	mptcp_loc_id;
+	u8	mptcp_rem_id;
+	u8	mptcp_flags;
 	u64	temp;			/* temp and everything after is not
 					 * initialized to 0 before calling
 					 * the BPF program. New fields that
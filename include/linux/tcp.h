@@ -490,6 +490,7 @@ struct tcp_sock {
 	u64		mptcp_loc_key;
 	char		mptcp_sched_name[MPTCP_SCHED_NAME_MAX];
 	char		mptcp_pm_name[MPTCP_PM_NAME_MAX];
+	u32		mptcp_target_rate; /* Goodput goal for the scheduler */
 #endif /* CONFIG_MPTCP */
 };
 
@@ -224,6 +224,20 @@ struct flow_dissector_key_ct {
 	u32	ct_labels[4];
 };
 
+#define FLOW_DIS_MPTCP_OPTION	BIT(0)	/* Segment carries an MPTCP option */
+
+/**
+ * struct flow_dissector_key_mptcp:
+ * @token: token of an MP_JOIN SYN, as on the wire
+ * @subtype: subtype of the first MPTCP option
+ * @flags: FLOW_DIS_MPTCP_*
+ */
+struct flow_dissector_key_mptcp {
+	__be32	token;
+	u8	subtype;
+	u8	flags;
+};
+
 enum flow_dissector_key_id {
 	FLOW_DISSECTOR_KEY_CONTROL, /* struct flow_dissector_key_control */
 	FLOW_DISSECTOR_KEY_BASIC, /* struct flow_dissector_key_basic */
@@ -252,6 +266,7 @@ enum flow_dissector_key_id {
 	FLOW_DISSECTOR_KEY_ENC_OPTS, /* struct flow_dissector_key_enc_opts */
 	FLOW_DISSECTOR_KEY_META, /* struct flow_dissector_key_meta */
 	FLOW_DISSECTOR_KEY_CT, /* struct flow_dissector_key_ct */
+	FLOW_DISSECTOR_KEY_MPTCP, /* struct flow_dissector_key_mptcp */
 
 	FLOW_DISSECTOR_KEY_MAX,
 };
@@ -33,6 +33,7 @@
 #include <linux/inetdevice.h>
 #include <linux/ipv6.h>
 #include <linux/list.h>
+#include <linux/llist.h>
 #include <linux/net.h>
 #include <linux/netpoll.h>
 #include <linux/siphash.h>
@@ -81,6 +82,20 @@ struct mptcp_rem6 {
 	struct in6_addr	addr;
 };
 
+/* A subflow that has been closed because the connection was idle and that
+ * will be re-established once there is data to send again.
+ */
+struct mptcp_parked_sub {
+	union inet_addr	loc;
+	union inet_addr	rem;
+	__be16		rem_port;
+	sa_family_t	family;
+	int		if_idx;
+	u8		loc_id;
+	u8		rem_id;
+	u8		low_prio:1;
+};
+
 struct mptcp_request_sock {
 	struct tcp_request_sock		req;
 	struct hlist_nulls_node		hash_entry;
@@ -157,6 +172,76 @@ struct mptcp_options_received {
 	u8	mptcp_recv_mac[20];
 };
 
+/* Shared bottleneck detection (RFC 8382), based on the RTT-samples */
+struct mptcp_sbd {
+	u64	sum_rtt;	/* Sum of the RTT-samples of this interval */
+	u64	sum_var;	/* Sum of |rtt - mean_delay| of this interval */
+	u32	t_start;	/* Start of this interval, in jiffies */
+	u32	cnt;		/* Number of RTT-samples in this interval */
+	s32	skew;		/* +1 per sample below mean_delay, -1 above */
+	u32	retrans;	/* total_retrans at the start of the interval */
+	u32	segs_out;	/* segs_out at the start of the interval */
+
+	u32	mean_delay;	/* Mean RTT over the last intervals, in us */
+	u32	var_est;	/* Mean absolute deviation of the RTT, in us */
+	s32	skew_est;	/* Skewness, scaled by MPTCP_SBD_ONE */
+	u32	freq_est;	/* Oscillations around mean_delay, scaled */
+	u32	loss_est;	/* Loss-rate, scaled by MPTCP_SBD_ONE */
+
+	u8	intervals;	/* Intervals seen so far, up to the warm-up */
+	s8	last_side;	/* Side of mean_delay of the last interval */
+	u8	bottleneck:1;	/* Currently found to be bottlenecked */
+	u8	cluster;	/* Only subflows of the same cluster are coupled */
+};
+
+/* What the last subflows on a path experienced, see mptcp_metrics.c */
+struct mptcp_path_metrics {
+	struct hlist_node	node;
+	struct rcu_head		rcu;
+	possible_net_t		net;
+
+	union inet_addr		loc;
+	union inet_addr		rem;
+	sa_family_t		family;
+	int			if_idx;
+
+	unsigned long		stamp;		/* Last update, in jiffies */
+	u32			srtt_us;	/* Smoothed RTT, << 3 */
+	u32			rttvar_us;	/* Mean deviation, << 2 */
+	u64			rate;		/* Delivery-rate, in bytes/s */
+	u32			loss;		/* Retransmissions per 1024 segs */
+	u32			cwnd;
+};
+
+#define MPTCP_POLICY_MAX_IF	8
+
+/* Rule of the path-manager policy table, see mptcp_policy.c */
+struct mptcp_policy {
+	struct hlist_node	node;
+	struct rcu_head		rcu;
+	refcount_t		refcnt;
+	possible_net_t		net;
+
+	u32			id;
+	u32			prio;		/* Lowest matching rule wins */
+
+	/* Match - AF_UNSPEC, a dport of 0 and a cgroup of 0 are wildcards */
+	sa_family_t		family;
+	u8			plen;
+	union inet_addr		daddr;
+	__be16			dport;
+	u32			mark;
+	u32			mark_mask;
+	u64			cgroup;
+
+	/* Action - the interface-lists are 0-terminated */
+	u8			subflows;	/* 0 keeps the PM's default */
+	int			if_allow[MPTCP_POLICY_MAX_IF];
+	int			if_deny[MPTCP_POLICY_MAX_IF];
+	int			if_backup[MPTCP_POLICY_MAX_IF];
+	char			sched[MPTCP_SCHED_NAME_MAX];
+};
+
 struct mptcp_tcp_sock {
 	struct hlist_node node;
 	struct hlist_node cb_list;
@@ -177,9 +262,12 @@ struct mptcp_tcp_sock {
 		low_prio:1, /* use this socket as backup */
 		rcv_low_prio:1, /* Peer sent low-prio option to us */
 		send_mp_prio:1, /* Trigger to send mp_prio on this socket */
-		pre_established:1; /* State between sending 3rd ACK and
+		pre_established:1, /* State between sending 3rd ACK and
 				    * receiving the fourth ack of new subflows.
 				    */
+		join_early:1, /* May send data while pre_established */
+		join_early_sent:1, /* Did send data while pre_established */
+		close_pending:1; /* Queued for the batched close */
 
 	/* isn: needed to translate abs to relative subflow seqnums */
 	u32	snt_isn;
@@ -188,6 +276,7 @@ struct mptcp_tcp_sock {
 	u8	loc_id;
 	u8	rem_id;
 	u8	sk_err;
+	u8	cost; /* Cost of this path, set by the path-manager */
 
 #define MPTCP_SCHED_SIZE 16
 	u8	mptcp_sched[MPTCP_SCHED_SIZE] __aligned(8);
@@ -195,15 +284,23 @@ struct mptcp_tcp_sock {
 	int	init_rcv_wnd;
 	u32	infinite_cutoff_seq;
 	struct delayed_work work;
+	struct llist_node close_node;	/* In mpcb->close_list */
 	u32	mptcp_loc_nonce;
 	struct tcp_sock *tp;
 	u32	last_end_data_seq;
 
+	/* First word of the DSS-option, for every combination of the F- and
+	 * M-flags (see mptcp_init_dss_tmpl()).
+	 */
+	__be32	dss_tmpl[4];
+
 	/* MP_JOIN subflow: timer for retransmitting the 3rd ack */
 	struct timer_list mptcp_ack_timer;
 
 	/* HMAC of the third ack */
 	char sender_mac[SHA256_DIGEST_SIZE];
+
+	struct mptcp_sbd sbd;
 };
 
 struct mptcp_tw {
@@ -288,7 +385,7 @@ struct mptcp_cb {
 		rcv_hiseq_index:1, /* Index in rcv_high_order of rcv_nxt */
 		tcp_ca_explicit_set:1; /* was meta CC set by app? */
 
-#define MPTCP_SCHED_DATA_SIZE 8
+#define MPTCP_SCHED_DATA_SIZE 16
 	u8 mptcp_sched[MPTCP_SCHED_DATA_SIZE] __aligned(8);
 	const struct mptcp_sched_ops *sched_ops;
 
@@ -346,6 +443,53 @@ struct mptcp_cb {
 	u32 orig_window_clamp;
 
 	struct tcp_info	*master_info;
+
+	/* Pure ACKs sent on any of the subflows */
+	u64	pure_acks_sent;
+
+	/* Sum of bytes_acked * cost of the subflows that are gone */
+	u64	cost_bytes_acked;
+
+	/* Opportunistic retransmissions of the rtx-queue head and
+	 * penalizations of slow subflows upon window-stalls.
+	 */
+	u64	opti_retrans_bytes;
+	u32	opti_retrans;
+	u32	opti_penal;
+
+	/* Segments sent out of the reinject-queue */
+	u32	reinjects_sent;
+
+	/* Bumped whenever a subflow gets added or removed */
+	u32	sub_gen;
+
+	/* Bumped by the coupled congestion-controls whenever a subflow changes
+	 * its CA-state. Each subflow then recomputes its coupled increase in
+	 * its own CA-state - the other subflows may run another CC.
+	 */
+	u32	cc_gen;
+
+	/* Last backoff of a channel-group of mctcpdesync, and the subflow that
+	 * backed off.
+	 */
+	u64	cc_off_tstamp;
+	u8	cc_off_path_index;
+
+	/* CPU the application last called into the socket from, -1 if none */
+	int	app_cpu;
+
+	/* Subflows closed while idle, to be re-established on demand */
+	struct delayed_work	park_work;
+	struct mptcp_parked_sub	*parked;
+	u8			parked_cnt;
+	u8			unpark_pending:1;
+
+	/* Rule of the policy table this session was created with */
+	struct mptcp_policy	*policy;
+
+	/* Subflows to close, all at once by close_work */
+	struct llist_head	close_list;
+	struct work_struct	close_work;
 };
 
 #define MPTCP_VERSION_0 0
@@ -699,8 +843,24 @@ extern int sysctl_mptcp_version;
 extern int sysctl_mptcp_checksum;
 extern int sysctl_mptcp_debug;
 extern int sysctl_mptcp_syn_retries;
+extern int sysctl_mptcp_ack_economy;
+extern int sysctl_mptcp_idle_park;
+extern int sysctl_mptcp_unpark_latency;
+extern int sysctl_mptcp_sbd;
+extern int sysctl_mptcp_path_metrics;
+extern int sysctl_mptcp_join_early_data;
+extern int sysctl_mptcp_lazy_token;
+extern int sysctl_mptcp_opti_budget;
+extern int sysctl_mptcp_cpu_affinity;
+extern int sysctl_mptcp_server_id_bits;
+extern int sysctl_mptcp_server_id;
+
+/* Values of sysctl_mptcp_cpu_affinity */
+#define MPTCP_CPU_AFFINITY_APP		1 /* Follow the application's CPU */
+#define MPTCP_CPU_AFFINITY_SPREAD	2 /* Spread the subflows over CPUs */
 
 extern struct workqueue_struct *mptcp_wq;
+extern struct workqueue_struct *mptcp_conn_wq;
 
 #define mptcp_debug(fmt, args...)						\
 	do {									\
@@ -730,6 +890,7 @@ static inline struct sock *mptcp_to_sock(const struct mptcp_tcp_sock *mptcp)
 #define MPTCP_INC_STATS(net, field)	SNMP_INC_STATS((net)->mptcp.mptcp_statistics, field)
 #define MPTCP_DEC_STATS(net, field)	SNMP_DEC_STATS((net)->mptcp.mptcp_statistics, field)
 #define MPTCP_INC_STATS_BH(net, field)	__SNMP_INC_STATS((net)->mptcp.mptcp_statistics, field)
+#define MPTCP_ADD_STATS(net, field, val)	SNMP_ADD_STATS((net)->mptcp.mptcp_statistics, field, val)
 
 enum
 {
@@ -776,6 +937,16 @@ enum
 	MPTCP_MIB_REMADDRTX,		/* Sent a REMOVE_ADDR */
 	MPTCP_MIB_JOINALTERNATEPORT,	/* Established a subflow on a different destination port-number */
 	MPTCP_MIB_CURRESTAB,		/* Current established MPTCP connections */
+	MPTCP_MIB_WINUPDATETX,		/* Sent a window-update upon recvmsg */
+	MPTCP_MIB_WINUPDATESAVED,	/* Window-update covered by an ACK on another subflow */
+	MPTCP_MIB_SUBPARKED,		/* Subflow closed because the connection was idle */
+	MPTCP_MIB_SUBUNPARKED,		/* Parked subflow re-established */
+	MPTCP_MIB_JOINEARLYDATA,	/* Sent data on a subflow before the fourth ACK */
+	MPTCP_MIB_JOINEARLYFAIL,	/* Subflow with early data failed before the fourth ACK */
+	MPTCP_MIB_TOKENCOLLISION,	/* Token already taken when creating the meta-socket */
+	MPTCP_MIB_OPTIRETRANS,		/* Opportunistic retransmissions of the meta rtx-queue head */
+	MPTCP_MIB_OPTIRETRANSBYTES,	/* Bytes sent by opportunistic retransmissions */
+	MPTCP_MIB_OPTIPENAL,		/* Slow subflows penalized upon a window-stall */
 	__MPTCP_MIB_MAX
 };
 
@@ -794,7 +965,13 @@ extern siphash_key_t mptcp_secret;
 /* This is needed to ensure that two subsequent key/nonce-generation result in
  * different keys/nonces if the IPs and ports are the same.
  */
-extern u32 mptcp_seed;
+extern atomic_t mptcp_seed;
+
+/* Keys are derived outside of mptcp_tk_hashlock */
+static inline u32 mptcp_next_seed(void)
+{
+	return atomic_inc_return(&mptcp_seed);
+}
 
 extern struct mptcp_hashtable mptcp_tk_htable;
 
@@ -866,8 +1043,39 @@ void mptcp_meta_retransmit_timer(struct sock *meta_sk);
 void mptcp_sub_retransmit_timer(struct sock *sk);
 int mptcp_write_wakeup(struct sock *meta_sk, int mib);
 void mptcp_sub_close_wq(struct work_struct *work);
+void mptcp_sub_close_batch_wq(struct work_struct *work);
 void mptcp_sub_close(struct sock *sk, unsigned long delay);
 struct sock *mptcp_select_ack_sock(const struct sock *meta_sk);
+void mptcp_sbd_pkts_acked(struct sock *sk, const struct ack_sample *sample);
+void mptcp_metrics_init_sub(struct sock *sk);
+void mptcp_metrics_update(struct sock *sk);
+bool mptcp_metrics_path_bad4(const struct sock *meta_sk,
+			     const struct mptcp_loc4 *loc,
+			     const struct mptcp_rem4 *rem);
+bool mptcp_metrics_path_bad6(const struct sock *meta_sk,
+			     const struct mptcp_loc6 *loc,
+			     const struct mptcp_rem6 *rem);
+int mptcp_metrics_dump(struct net *net, unsigned long *pos,
+		       int (*fill)(const struct mptcp_path_metrics *pm, void *arg),
+		       void *arg);
+void mptcp_metrics_flush(struct net *net, sa_family_t family,
+			 const union inet_addr *loc, const union inet_addr *rem);
+int mptcp_metrics_init(void);
+void mptcp_metrics_undo(void);
+void mptcp_policy_apply(struct mptcp_cb *mpcb);
+void mptcp_policy_put(struct mptcp_policy *pol);
+int mptcp_policy_num_subflows(const struct mptcp_cb *mpcb, int def);
+bool mptcp_policy_if_allowed(const struct mptcp_cb *mpcb, int if_idx);
+bool mptcp_policy_if_backup(const struct mptcp_cb *mpcb, int if_idx);
+int mptcp_policy_add(struct net *net, const struct mptcp_policy *tmpl);
+int mptcp_policy_del(struct net *net, u32 id);
+void mptcp_policy_flush(struct net *net);
+int mptcp_policy_dump(struct net *net, unsigned long *pos,
+		      int (*fill)(const struct mptcp_policy *pol, void *arg),
+		      void *arg);
+int mptcp_policy_init(void);
+void mptcp_policy_undo(void);
+void mptcp_unpark_check(struct sock *meta_sk);
 void mptcp_prepare_for_backlog(struct sock *sk, struct sk_buff *skb);
 void mptcp_initialize_recv_vars(struct tcp_sock *meta_tp, struct mptcp_cb *mpcb,
 				__u64 remote_key);
@@ -903,6 +1111,7 @@ void mptcp_reqsk_destructor(struct request_sock *req);
 void mptcp_connect_init(struct sock *sk);
 void mptcp_sub_force_close(struct sock *sk);
 int mptcp_sub_len_remove_addr_align(u16 bitfield);
+void mptcp_init_dss_tmpl(struct tcp_sock *tp);
 void mptcp_join_reqsk_init(const struct mptcp_cb *mpcb,
 			   const struct request_sock *req,
 			   struct sk_buff *skb);
@@ -918,6 +1127,10 @@ void mptcp_cookies_reqsk_init(struct request_sock *req,
 void mptcp_mpcb_put(struct mptcp_cb *mpcb);
 int mptcp_finish_handshake(struct sock *child, struct sk_buff *skb);
 int mptcp_get_info(const struct sock *meta_sk, char __user *optval, int optlen);
+int mptcp_get_info_ext(const struct sock *meta_sk, char __user *optval,
+		       int optlen);
+void mptcp_record_flow(struct sock *meta_sk);
+int mptcp_work_cpu(const struct mptcp_cb *mpcb, const struct sock *sk);
 void mptcp_clear_sk(struct sock *sk, int size);
 
 /* MPTCP-path-manager registration/initialization functions */
@@ -928,6 +1141,7 @@ void mptcp_cleanup_path_manager(struct mptcp_cb *mpcb);
 void mptcp_fallback_default(struct mptcp_cb *mpcb);
 void mptcp_get_default_path_manager(char *name);
 int mptcp_set_scheduler(struct sock *sk, const char *name);
+bool mptcp_sched_available(const char *name);
 int mptcp_set_path_manager(struct sock *sk, const char *name);
 int mptcp_set_default_path_manager(const char *name);
 extern struct mptcp_pm_ops mptcp_pm_default;
@@ -950,8 +1164,31 @@ struct sk_buff *mptcp_next_segment(struct sock *meta_sk,
 				   int *reinject,
 				   struct sock **subsk,
 				   unsigned int *limit);
+u64 mptcp_sub_rate(const struct tcp_sock *tp);
+u32 mptcp_ofo_occupancy(const struct tcp_sock *meta_tp,
+			const struct sk_buff *skb_head);
 extern struct mptcp_sched_ops mptcp_sched_default;
 
+/* Per-segment scheduler calls, direct for the default scheduler */
+static inline struct sock *mptcp_sched_get_subflow(struct sock *meta_sk,
+						   struct sk_buff *skb,
+						   bool zero_wnd_test)
+{
+	return INDIRECT_CALL_1(tcp_sk(meta_sk)->mpcb->sched_ops->get_subflow,
+			       get_available_subflow, meta_sk, skb,
+			       zero_wnd_test);
+}
+
+static inline struct sk_buff *mptcp_sched_next_segment(struct sock *meta_sk,
+						       int *reinject,
+						       struct sock **subsk,
+						       unsigned int *limit)
+{
+	return INDIRECT_CALL_1(tcp_sk(meta_sk)->mpcb->sched_ops->next_segment,
+			       mptcp_next_segment, meta_sk, reinject, subsk,
+			       limit);
+}
+
 /* Initializes function-pointers and MPTCP-flags */
 static inline void mptcp_init_tcp_sock(struct sock *sk)
 {
@@ -1212,11 +1449,19 @@ static inline void mptcp_check_rcvseq_wrap(struct tcp_sock *meta_tp,
 	}
 }
 
+/* We do not send data on a new subflow unless it is fully established, i.e.
+ * the 4th ack has been received - except with mptcp_join_early_data.
+ */
+static inline bool mptcp_sub_wait_fourth_ack(const struct tcp_sock *tp)
+{
+	return tp->mptcp->pre_established && !tp->mptcp->join_early;
+}
+
 static inline int mptcp_sk_can_send(const struct sock *sk)
 {
 	return tcp_passive_fastopen(sk) ||
 	       ((1 << sk->sk_state) & (TCPF_ESTABLISHED | TCPF_CLOSE_WAIT) &&
-		!tcp_sk(sk)->mptcp->pre_established);
+		!mptcp_sub_wait_fourth_ack(tcp_sk(sk)));
 }
 
 static inline int mptcp_sk_can_recv(const struct sock *sk)
@@ -1296,6 +1541,8 @@ static inline void mptcp_fallback_close(struct mptcp_cb *mpcb,
 {
 	mptcp_sub_force_close_all(mpcb, except);
 
+	tcp_call_bpf(except, BPF_SOCK_OPS_MPTCP_FALLBACK_CB, 0, NULL);
+
 	if (mpcb->pm_ops->close_session)
 		mpcb->pm_ops->close_session(mptcp_meta_sk(except));
 }
@@ -1370,6 +1617,21 @@ static inline bool mptcp_can_new_subflow(const struct sock *meta_sk)
 	       !tcp_sk(meta_sk)->mpcb->send_infinite_mapping;
 }
 
+static inline void mptcp_account_pure_ack(const struct sock *sk)
+{
+	tcp_sk(sk)->mpcb->pure_acks_sent++;
+}
+
+/* Should the coupled congestion-controls couple sk with sub_sk? Without
+ * shared bottleneck detection, all the subflows are coupled.
+ */
+static inline bool mptcp_sbd_coupled(const struct sock *sk,
+				     const struct sock *sub_sk)
+{
+	return !sysctl_mptcp_sbd ||
+	       tcp_sk(sk)->mptcp->sbd.cluster == tcp_sk(sub_sk)->mptcp->sbd.cluster;
+}
+
 static inline int mptcp_subflow_count(const struct mptcp_cb *mpcb)
 {
 	struct mptcp_tcp_sock *mptcp;
@@ -1565,6 +1827,13 @@ static inline bool mptcp_can_new_subflow(const struct sock *meta_sk)
 {
 	return false;
 }
+static inline void mptcp_account_pure_ack(const struct sock *sk) {}
+static inline void mptcp_record_flow(struct sock *meta_sk) {}
+static inline bool mptcp_sbd_coupled(const struct sock *sk,
+				     const struct sock *sub_sk)
+{
+	return true;
+}
 
 #endif /* CONFIG_MPTCP */
 
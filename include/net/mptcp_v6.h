@@ -31,6 +31,7 @@
 #define _MPTCP_V6_H
 
 #include <linux/in6.h>
+#include <linux/seg6.h>
 #include <net/if_inet6.h>
 
 #include <net/mptcp.h>
@@ -49,6 +50,7 @@ struct sock *mptcp_v6_search_req(const __be16 rport, const struct in6_addr *radd
 int __mptcp_init6_subsockets(struct sock *meta_sk, const struct mptcp_loc6 *loc,
 			     __be16 sport, struct mptcp_rem6 *rem,
 			     struct sock **subsk);
+int mptcp_v6_set_srh(struct sock *sk, struct ipv6_sr_hdr *srh);
 int mptcp_pm_v6_init(void);
 void mptcp_pm_v6_undo(void);
 __u32 mptcp_v6_get_nonce(const __be32 *saddr, const __be32 *daddr,
@@ -44,6 +44,7 @@
 #include <linux/memcontrol.h>
 #include <linux/bpf-cgroup.h>
 #include <linux/siphash.h>
+#include <linux/indirect_call_wrapper.h>
 
 extern struct inet_hashinfo tcp_hashinfo;
 
@@ -2190,6 +2191,87 @@ struct tcp_sock_ops {
 };
 extern const struct tcp_sock_ops tcp_specific;
 
+/* The hot tcp_sock_ops are called through these wrappers, so that plain TCP
+ * sockets (and MPTCP subflows, which mostly share the TCP operations) and
+ * the MPTCP meta-socket get a direct call instead of a retpoline.
+ */
+#ifdef CONFIG_MPTCP
+u32 __mptcp_select_window(struct sock *sk);
+u16 mptcp_select_window(struct sock *sk);
+void mptcp_tcp_set_rto(struct sock *sk);
+bool mptcp_should_expand_sndbuf(const struct sock *sk);
+void mptcp_send_fin(struct sock *meta_sk);
+bool mptcp_write_xmit(struct sock *sk, unsigned int mss_now, int nonagle,
+		      int push_one, gfp_t gfp);
+int mptcp_write_wakeup(struct sock *meta_sk, int mib);
+void mptcp_meta_retransmit_timer(struct sock *meta_sk);
+void mptcp_cleanup_rbuf(struct sock *meta_sk, int copied);
+
+/* INDIRECT_CALL_2() tests its first candidate under likely() - plain TCP */
+#define TCP_OPS_CALL(f, f_mptcp, f_tcp, ...)				\
+	INDIRECT_CALL_2(f, f_tcp, f_mptcp, __VA_ARGS__)
+#else
+#define TCP_OPS_CALL(f, f_mptcp, f_tcp, ...)				\
+	INDIRECT_CALL_1(f, f_tcp, __VA_ARGS__)
+#endif
+
+static inline u32 tcp_ops___select_window(struct sock *sk)
+{
+	return TCP_OPS_CALL(tcp_sk(sk)->ops->__select_window,
+			    __mptcp_select_window, __tcp_select_window, sk);
+}
+
+static inline u16 tcp_ops_select_window(struct sock *sk)
+{
+	return TCP_OPS_CALL(tcp_sk(sk)->ops->select_window,
+			    mptcp_select_window, tcp_select_window, sk);
+}
+
+static inline void tcp_ops_set_rto(struct sock *sk)
+{
+	TCP_OPS_CALL(tcp_sk(sk)->ops->set_rto, mptcp_tcp_set_rto, tcp_set_rto,
+		     sk);
+}
+
+static inline bool tcp_ops_should_expand_sndbuf(const struct sock *sk)
+{
+	return TCP_OPS_CALL(tcp_sk(sk)->ops->should_expand_sndbuf,
+			    mptcp_should_expand_sndbuf,
+			    tcp_should_expand_sndbuf, sk);
+}
+
+static inline void tcp_ops_send_fin(struct sock *sk)
+{
+	TCP_OPS_CALL(tcp_sk(sk)->ops->send_fin, mptcp_send_fin, tcp_send_fin,
+		     sk);
+}
+
+static inline bool tcp_ops_write_xmit(struct sock *sk, unsigned int mss_now,
+				      int nonagle, int push_one, gfp_t gfp)
+{
+	return TCP_OPS_CALL(tcp_sk(sk)->ops->write_xmit, mptcp_write_xmit,
+			    tcp_write_xmit, sk, mss_now, nonagle, push_one,
+			    gfp);
+}
+
+static inline int tcp_ops_write_wakeup(struct sock *sk, int mib)
+{
+	return TCP_OPS_CALL(tcp_sk(sk)->ops->write_wakeup, mptcp_write_wakeup,
+			    tcp_write_wakeup, sk, mib);
+}
+
+static inline void tcp_ops_retransmit_timer(struct sock *sk)
+{
+	TCP_OPS_CALL(tcp_sk(sk)->ops->retransmit_timer,
+		     mptcp_meta_retransmit_timer, tcp_retransmit_timer, sk);
+}
+
+static inline void tcp_ops_cleanup_rbuf(struct sock *sk, int copied)
+{
+	TCP_OPS_CALL(tcp_sk(sk)->ops->cleanup_rbuf, mptcp_cleanup_rbuf,
+		     tcp_cleanup_rbuf, sk, copied);
+}
+
 struct tcp_request_sock_ops {
 	u16 mss_clamp;
 #ifdef CONFIG_TCP_MD5SIG
@@ -2406,6 +2488,10 @@ int __tcp_bpf_recvmsg(struct sock *sk, struct sk_psock *psock,
  * program loaded).
  */
 #ifdef CONFIG_BPF
+#ifdef CONFIG_MPTCP
+void mptcp_init_sock_ops(struct bpf_sock_ops_kern *sock_ops, struct sock *sk);
+#endif
+
 static inline int tcp_call_bpf(struct sock *sk, int op, u32 nargs, u32 *args)
 {
 	struct bpf_sock_ops_kern sock_ops;
@@ -2414,7 +2500,13 @@ static inline int tcp_call_bpf(struct sock *sk, int op, u32 nargs, u32 *args)
 	memset(&sock_ops, 0, offsetof(struct bpf_sock_ops_kern, temp));
 	if (sk_fullsock(sk)) {
 		sock_ops.is_fullsock = 1;
-		sock_owned_by_me(sk);
+#ifdef CONFIG_MPTCP
+		/* Checks the meta-socket's lock instead */
+		if (mptcp(tcp_sk(sk)))
+			mptcp_init_sock_ops(&sock_ops, sk);
+		else
+#endif
+			sock_owned_by_me(sk);
 	}
 
 	sock_ops.sk = sk;
@@ -13,6 +13,9 @@
 #ifndef _LINUX_MPTCP_H
 #define _LINUX_MPTCP_H
 
+#include <linux/types.h>
+#include <asm/byteorder.h>
+
 #define MPTCP_GENL_NAME		"mptcp"
 #define MPTCP_GENL_EV_GRP_NAME	"mptcp_events"
 #define MPTCP_GENL_CMD_GRP_NAME "mptcp_commands"
@@ -39,6 +42,27 @@ enum {
 	MPTCP_ATTR_FLAGS,	/* u16 */
 	MPTCP_ATTR_TIMEOUT,	/* u32 */
 	MPTCP_ATTR_IF_IDX,	/* s32 */
+	MPTCP_ATTR_COST,	/* u8 */
+	MPTCP_ATTR_RTT,		/* u32, in us */
+	MPTCP_ATTR_RTTVAR,	/* u32, in us */
+	MPTCP_ATTR_RATE,	/* u64, in bytes/s */
+	MPTCP_ATTR_LOSS,	/* u32, retransmissions per 1024 segments */
+	MPTCP_ATTR_CWND,	/* u32 */
+	MPTCP_ATTR_AGE,		/* u32, in ms */
+	MPTCP_ATTR_PAD,
+	MPTCP_ATTR_POLICY_ID,	/* u32 */
+	MPTCP_ATTR_PRIO,	/* u32 */
+	MPTCP_ATTR_PREFIXLEN,	/* u8 */
+	MPTCP_ATTR_MARK,	/* u32 */
+	MPTCP_ATTR_MARK_MASK,	/* u32 */
+	MPTCP_ATTR_CGROUP,	/* u64 */
+	MPTCP_ATTR_SUBFLOWS,	/* u8 */
+	MPTCP_ATTR_IF_ALLOW,	/* s32[], up to 8 */
+	MPTCP_ATTR_IF_DENY,	/* s32[], up to 8 */
+	MPTCP_ATTR_IF_BACKUP,	/* s32[], up to 8 */
+	MPTCP_ATTR_SCHED,	/* string */
+	MPTCP_ATTR_REM_TOKEN,	/* u32 */
+	MPTCP_ATTR_SUBFLOW,	/* nested */
 
 	__MPTCP_ATTR_AFTER_LAST
 };
@@ -68,16 +92,16 @@ enum {
  *
  *   - MPTCP_EVENT_SUB_ESTABLISHED: token, family, saddr4 | saddr6,
  *                                  daddr4 | daddr6, sport, dport, backup,
- *                                  if_idx [, error]
+ *                                  if_idx, cost [, error]
  *       A new subflow has been established. 'error' should not be set.
  *
  *   - MPTCP_EVENT_SUB_CLOSED: token, family, saddr4 | saddr6, daddr4 | daddr6,
- *                             sport, dport, backup, if_idx [, error]
+ *                             sport, dport, backup, if_idx, cost [, error]
  *       A subflow has been closed. An error (copy of sk_err) could be set if an
  *       error has been detected for this subflow.
  *
  *   - MPTCP_EVENT_SUB_PRIORITY: token, family, saddr4 | saddr6, daddr4 | daddr6,
- *                               sport, dport, backup, if_idx [, error]
+ *                               sport, dport, backup, if_idx, cost [, error]
  *       The priority of a subflow has changed. 'error' should not be set.
  *
  * Commands for MPTCP:
@@ -89,15 +113,18 @@ enum {
  *
  *   - MPTCP_CMD_SUB_CREATE: token, family, loc_id, rem_id, [saddr4 | saddr6,
  *                           daddr4 | daddr6, dport [, sport, backup, if_idx]]
- *       Create a new subflow.
+ *                           [, cost]
+ *       Create a new subflow. 'cost' is used by the cost-aware scheduler,
+ *       0 being the cheapest (and default) one.
  *
  *   - MPTCP_CMD_SUB_DESTROY: token, family, saddr4 | saddr6, daddr4 | daddr6,
  *                            sport, dport
  *       Close a subflow.
  *
  *   - MPTCP_CMD_SUB_PRIORITY: token, family, saddr4 | saddr6, daddr4 | daddr6,
- *                             sport, dport, backup
- *       Change the priority of a subflow.
+ *                             sport, dport, backup | cost
+ *       Change the priority of a subflow. If only 'cost' is given, the
+ *       backup-flag is left unchanged and no MP_PRIO is sent.
  *
  *   - MPTCP_CMD_SET_FILTER: flags
  *       Set the filter on events. Set MPTCPF_* flags to only receive specific
@@ -105,6 +132,35 @@ enum {
  *
  *   - MPTCP_CMD_EXIST: token
  *       Check if this token is linked to an existing socket.
+ *
+ *   - MPTCP_CMD_METRICS_GET (dump): family, saddr4 | saddr6, daddr4 | daddr6,
+ *                                   if_idx, rtt, rttvar, rate, loss, cwnd, age
+ *       Dump the per-path metrics cache, one message per path.
+ *
+ *   - MPTCP_CMD_METRICS_FLUSH: [family [, saddr4 | saddr6] [, daddr4 | daddr6]]
+ *       Flush the per-path metrics cache, or only the matching paths.
+ *
+ *   - MPTCP_CMD_POLICY_ADD: policy_id [, prio, family, daddr4 | daddr6,
+ *                           prefixlen, dport, mark, mark_mask, cgroup]
+ *                           [, subflows, if_allow, if_deny, if_backup, sched]
+ *       Add a rule to the path-manager policy table, replacing the one with
+ *       the same id. Among the matching rules, the one with the lowest prio
+ *       applies to a new connection. It overrides the number of subflows of
+ *       the fullmesh and ndiffports path-managers, restricts the interfaces
+ *       subflows may use, marks subflows on if_backup as backup and selects
+ *       the scheduler.
+ *
+ *   - MPTCP_CMD_POLICY_DEL: [policy_id]
+ *       Remove a rule, or all of them if no id is given.
+ *
+ *   - MPTCP_CMD_POLICY_GET (dump): policy_id, prio, family, ...
+ *       Dump the policy table, one message per rule.
+ *
+ *   - MPTCP_CMD_SESSION_GET (dump): token, rem_token, family, saddr4 | saddr6,
+ *                                   daddr4 | daddr6, sport, dport, subflow*
+ *       Dump all connections of the netns, e.g., to resynchronize after a
+ *       restart or a multicast overrun. Every 'subflow' is nested and has the
+ *       attributes of MPTCP_EVENT_SUB_ESTABLISHED (but the token).
  */
 enum {
 	MPTCP_CMD_UNSPEC = 0,
@@ -130,6 +186,15 @@ enum {
 
 	MPTCP_CMD_EXIST,
 
+	MPTCP_CMD_METRICS_GET,
+	MPTCP_CMD_METRICS_FLUSH,
+
+	MPTCP_CMD_POLICY_ADD,
+	MPTCP_CMD_POLICY_DEL,
+	MPTCP_CMD_POLICY_GET,
+
+	MPTCP_CMD_SESSION_GET,
+
 	__MPTCP_CMD_AFTER_LAST
 };
 
@@ -146,4 +211,22 @@ enum {
 	MPTCPF_EVENT_SUB_PRIORITY	= (1 << 8),
 };
 
+/*
+ * Server-id embedded in the tokens (net.mptcp.mptcp_server_id_bits).
+ *
+ * With mptcp_server_id_bits = n > 0, the n most significant bits of every
+ * local token hold net.mptcp.mptcp_server_id. As the token is carried in
+ * network byte-order in the MP_JOIN SYN (RFC 8684, section 3.2), these are
+ * the leading bits of its first byte. A load-balancer, e.g. an XDP program,
+ * can thus steer an MP_JOIN SYN with only:
+ *
+ *	server = mptcp_token_server_id(token_from_the_option, n);
+ */
+#define MPTCP_SERVER_ID_BITS_MAX	8
+
+static __inline__ __u32 mptcp_token_server_id(__be32 token, unsigned int bits)
+{
+	return __be32_to_cpu(token) >> (32 - bits);
+}
+
 #endif /* _LINUX_MPTCP_H */
@@ -548,6 +548,11 @@ enum {
 	TCA_FLOWER_KEY_CT_LABELS,	/* u128 */
 	TCA_FLOWER_KEY_CT_LABELS_MASK,	/* u128 */
 
+	TCA_FLOWER_KEY_MPTCP_SUBTYPE,	/* u8 */
+	TCA_FLOWER_KEY_MPTCP_SUBTYPE_MASK, /* u8 */
+	TCA_FLOWER_KEY_MPTCP_TOKEN,	/* be32 - MP_JOIN SYNs only */
+	TCA_FLOWER_KEY_MPTCP_TOKEN_MASK, /* be32 */
+
 	__TCA_FLOWER_MAX,
 };
 
@@ -144,9 +144,23 @@ enum {
 #define MPTCP_SCHEDULER		43
 #define MPTCP_PATH_MANAGER	44
 #define MPTCP_INFO		45
+#define MPTCP_TARGET_RATE	46	/* Target goodput in bytes per second */
+#define MPTCP_INFO_EXT		47
 
 #define MPTCP_INFO_FLAG_SAVE_MASTER	0x01
 
+#define MPTCP_INFO_EXT_VERSION		1
+
+/* mptcp_info_ext.flags */
+#define MPTCP_INFO_EXT_F_CHANGED	0x01	/* Only subflows active since cookie */
+
+/* mptcp_sub_ext.flags */
+#define MPTCP_SUB_EXT_F_BACKUP		0x01	/* We use it as backup */
+#define MPTCP_SUB_EXT_F_RCV_BACKUP	0x02	/* Peer uses it as backup */
+#define MPTCP_SUB_EXT_F_FULLY_EST	0x04
+#define MPTCP_SUB_EXT_F_PRE_EST		0x08	/* Waiting for the 4th ACK */
+#define MPTCP_SUB_EXT_F_MASTER		0x10
+
 struct tcp_repair_opt {
 	__u32	opt_code;
 	__u32	opt_val;
@@ -336,6 +350,13 @@ struct mptcp_meta_info {
 
 	__u64	mptcpi_bytes_acked;    /* RFC4898 tcpEStatsAppHCThruOctetsAcked */
 	__u64	mptcpi_bytes_received; /* RFC4898 tcpEStatsAppHCThruOctetsReceived */
+
+	__u64	mptcpi_pure_acks_sent; /* Pure ACKs sent across all subflows */
+	__u64	mptcpi_cost_bytes;     /* Bytes acked, weighted by the subflow's cost */
+
+	__u32	mptcpi_opti_retrans;   /* Opportunistic retransmissions of the meta head */
+	__u32	mptcpi_opti_penal;     /* Penalizations of slow subflows */
+	__u64	mptcpi_opti_retrans_bytes;
 };
 
 struct mptcp_sub_info {
@@ -352,6 +373,74 @@ struct mptcp_sub_info {
 	};
 };
 
+/* Layout of MPTCP_INFO_EXT. New fields only ever get appended to the
+ * structures, and the kernel copies min(user's, kernel's) length of each.
+ * Structures that grow on their own, like mptcp_meta_info, are passed
+ * through a pointer/length pair of their own rather than embedded.
+ */
+struct mptcp_meta_ext {
+	/* Data-sequence numbers, lower 32 bits */
+	__u32	snd_una;	/* DATA_ACK received from the peer */
+	__u32	snd_nxt;
+	__u32	rcv_nxt;	/* DATA_ACK sent to the peer */
+	__u32	snd_wnd;	/* Peer's receive-window */
+
+	__u32	ofo_bytes;	/* Span of our ofo-queue beyond rcv_nxt */
+	__u32	peer_ofo;	/* Estimated part of the peer's window taken by
+				 * ofo-data, scaled to 1024.
+				 */
+	__u32	reinject_queued; /* Segments waiting for reinjection */
+	__u32	reinjects_sent;
+
+	__u32	sub_gen;	/* Changes whenever the set of subflows does */
+	__u32	sub_cnt;
+
+	char	sched[16];	/* Name of the scheduler */
+};
+
+struct mptcp_sub_ext {
+	struct mptcp_sub_info	addrs;
+
+	__u8	path_index;
+	__u8	loc_id;
+	__u8	rem_id;
+	__u8	flags;		/* MPTCP_SUB_EXT_F_* */
+	__u8	state;
+	__u8	ca_state;
+	__u16	__pad;
+
+	__u32	srtt_us;
+	__u32	rttvar_us;
+	__u32	snd_cwnd;
+	__u32	snd_ssthresh;
+	__u32	packets_out;
+	__u32	retrans_out;
+	__u32	total_retrans;
+	__u32	data_segs_out;	/* Segments the scheduler put on this subflow */
+
+	__u64	delivery_rate;	/* Bytes per second */
+	__u64	bytes_acked;
+	__u64	bytes_received;
+	__u64	last_active_us;	/* Compare to mptcp_info_ext.cookie */
+};
+
+struct mptcp_info_ext {
+	__u32	version;	/* Out: MPTCP_INFO_EXT_VERSION */
+	__u32	flags;		/* In: MPTCP_INFO_EXT_F_* */
+	__u64	cookie;		/* In: from the previous call. Out: for the next */
+
+	__u32	info_len;	/* In/out: length of *info */
+	__u32	meta_len;	/* In/out: length of *meta */
+	__u32	sub_len;	/* In/out: length of each entry in *subflows */
+	__u32	sub_cnt;	/* In: entries in *subflows. Out: entries filled */
+	__u32	sub_total;	/* Out: number of subflows of the connection */
+	__u32	__pad;
+
+	struct mptcp_meta_info	*info;
+	struct mptcp_meta_ext	*meta;
+	struct mptcp_sub_ext	*subflows;
+};
+
 struct mptcp_info {
 	__u32	tcp_info_len;	/* Length of each struct tcp_info in subflows pointer */
 	__u32	sub_len;	/* Total length of memory pointed to by subflows pointer */
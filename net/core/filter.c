@@ -7068,6 +7068,7 @@ static bool sock_ops_is_valid_access(int off, int size,
 				return false;
 			break;
 		case offsetof(struct bpf_sock_ops, sk):
+		case offsetof(struct bpf_sock_ops, meta_sk):
 			if (size != sizeof(__u64))
 				return false;
 			info->reg_type = PTR_TO_SOCKET_OR_NULL;
@@ -8056,6 +8057,19 @@ static u32 sock_ops_convert_ctx_access(enum bpf_access_type type,
 #define SOCK_OPS_GET_TCP_SOCK_FIELD(FIELD) \
 		SOCK_OPS_GET_FIELD(FIELD, FIELD, struct tcp_sock)
 
+/* Helper macro for reading fields stored in bpf_sock_ops_kern itself. */
+#define SOCK_OPS_GET_KERN_FIELD(FIELD)					      \
+	do {								      \
+		BUILD_BUG_ON(FIELD_SIZEOF(struct bpf_sock_ops_kern, FIELD) >  \
+			     FIELD_SIZEOF(struct bpf_sock_ops, FIELD));	      \
+		*insn++ = BPF_LDX_MEM(BPF_FIELD_SIZEOF(			      \
+						struct bpf_sock_ops_kern,     \
+						FIELD),			      \
+				      si->dst_reg, si->src_reg,		      \
+				      offsetof(struct bpf_sock_ops_kern,      \
+					       FIELD));			      \
+	} while (0)
+
 /* Helper macro for adding write access to tcp_sock or sock fields.
  * The macro is called with two registers, dst_reg which contains a pointer
  * to ctx (context) and src_reg which contains the value that should be
@@ -8339,6 +8353,22 @@ static u32 sock_ops_convert_ctx_access(enum bpf_access_type type,
 	case offsetof(struct bpf_sock_ops, sk):
 		SOCK_OPS_GET_SK();
 		break;
+
+	case offsetof(struct bpf_sock_ops, mptcp_path_index):
+		SOCK_OPS_GET_KERN_FIELD(mptcp_path_index);
+		break;
+	case offsetof(struct bpf_sock_ops, mptcp_loc_id):
+		SOCK_OPS_GET_KERN_FIELD(mptcp_loc_id);
+		break;
+	case offsetof(struct bpf_sock_ops, mptcp_rem_id):
+		SOCK_OPS_GET_KERN_FIELD(mptcp_rem_id);
+		break;
+	case offsetof(struct bpf_sock_ops, mptcp_flags):
+		SOCK_OPS_GET_KERN_FIELD(mptcp_flags);
+		break;
+	case offsetof(struct bpf_sock_ops, meta_sk):
+		SOCK_OPS_GET_KERN_FIELD(meta_sk);
+		break;
 	}
 	return insn - insn_buf;
 }
@@ -24,6 +24,7 @@
 #include <linux/mpls.h>
 #include <linux/tcp.h>
 #include <net/flow_dissector.h>
+#include <net/mptcp.h>
 #include <scsi/fc/fc_fcoe.h>
 #include <uapi/linux/batadv_packet.h>
 #include <linux/bpf.h>
@@ -699,6 +700,71 @@ __skb_flow_dissect_tcp(const struct sk_buff *skb,
 	key_tcp->flags = (*(__be16 *) &tcp_flag_word(th) & htons(0x0FFF));
 }
 
+static void
+__skb_flow_dissect_mptcp(const struct sk_buff *skb,
+			 struct flow_dissector *flow_dissector,
+			 void *target_container, void *data, int thoff, int hlen)
+{
+	struct flow_dissector_key_mptcp *key_mptcp;
+	u8 _opts[MAX_TCP_OPTION_SPACE];
+	struct tcphdr *th, _th;
+	const u8 *ptr;
+	int length;
+
+	if (!dissector_uses_key(flow_dissector, FLOW_DISSECTOR_KEY_MPTCP))
+		return;
+
+	th = __skb_header_pointer(skb, thoff, sizeof(_th), data, hlen, &_th);
+	if (!th)
+		return;
+
+	length = __tcp_hdrlen(th) - sizeof(_th);
+	if (length <= 0 || length > MAX_TCP_OPTION_SPACE)
+		return;
+
+	ptr = __skb_header_pointer(skb, thoff + sizeof(_th), length, data,
+				   hlen, _opts);
+	if (!ptr)
+		return;
+
+	key_mptcp = skb_flow_dissector_target(flow_dissector,
+					      FLOW_DISSECTOR_KEY_MPTCP,
+					      target_container);
+
+	while (length > 0) {
+		int opcode = *ptr++;
+		int opsize;
+
+		if (opcode == TCPOPT_EOL)
+			return;
+		if (opcode == TCPOPT_NOP) {
+			length--;
+			continue;
+		}
+		if (length < 2)
+			return;
+		opsize = *ptr++;
+		if (opsize < 2 || opsize > length)
+			return;
+
+		if (opcode == TCPOPT_MPTCP && opsize > 2) {
+			key_mptcp->flags |= FLOW_DIS_MPTCP_OPTION;
+			key_mptcp->subtype = ptr[0] >> 4;
+
+			/* Only the SYN of an MP_JOIN carries the token */
+			if (key_mptcp->subtype == MPTCP_SUB_JOIN &&
+			    opsize == MPTCP_SUB_LEN_JOIN_SYN && th->syn &&
+			    !th->ack)
+				memcpy(&key_mptcp->token, ptr + 2,
+				       sizeof(key_mptcp->token));
+			return;
+		}
+
+		ptr += opsize - 2;
+		length -= opsize;
+	}
+}
+
 static void
 __skb_flow_dissect_ports(const struct sk_buff *skb,
 			 struct flow_dissector *flow_dissector,
@@ -1343,6 +1409,8 @@ bool __skb_flow_dissect(const struct net *net,
 	case IPPROTO_TCP:
 		__skb_flow_dissect_tcp(skb, flow_dissector, target_container,
 				       data, nhoff, hlen);
+		__skb_flow_dissect_mptcp(skb, flow_dissector, target_container,
+					 data, nhoff, hlen);
 		break;
 
 	default:
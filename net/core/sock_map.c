@@ -10,6 +10,7 @@
 #include <linux/skmsg.h>
 #include <linux/list.h>
 #include <linux/jhash.h>
+#include <net/mptcp.h>
 
 struct bpf_stab {
 	struct bpf_map map;
@@ -431,10 +432,28 @@ static bool sock_map_op_okay(const struct bpf_sock_ops_kern *ops)
 	       ops->op == BPF_SOCK_OPS_ACTIVE_ESTABLISHED_CB;
 }
 
+/* An MPTCP connection is represented by its meta-socket, which sees the
+ * in-order data stream. Subflows only carry fragments of it and must never
+ * get a psock of their own.
+ */
 static bool sock_map_sk_is_suitable(const struct sock *sk)
 {
 	return sk->sk_type == SOCK_STREAM &&
-	       sk->sk_protocol == IPPROTO_TCP;
+	       sk->sk_protocol == IPPROTO_TCP &&
+	       (!mptcp(tcp_sk(sk)) || is_meta_sk(sk));
+}
+
+/* The established callbacks of an MPTCP connection run on its initial
+ * subflow, with the meta-socket locked. Insert the meta-socket instead,
+ * and ignore the callbacks of the subflows joining later on.
+ */
+static struct sock *sock_map_ops_sk(struct sock *sk)
+{
+	if (sk->sk_protocol == IPPROTO_TCP && mptcp(tcp_sk(sk)) &&
+	    !is_meta_sk(sk))
+		return is_master_tp(tcp_sk(sk)) ? mptcp_meta_sk(sk) : NULL;
+
+	return sk;
 }
 
 static int sock_map_update_elem(struct bpf_map *map, void *key,
@@ -473,12 +492,16 @@ static int sock_map_update_elem(struct bpf_map *map, void *key,
 BPF_CALL_4(bpf_sock_map_update, struct bpf_sock_ops_kern *, sops,
 	   struct bpf_map *, map, void *, key, u64, flags)
 {
+	struct sock *sk;
+
 	WARN_ON_ONCE(!rcu_read_lock_held());
 
-	if (likely(sock_map_sk_is_suitable(sops->sk) &&
-		   sock_map_op_okay(sops)))
-		return sock_map_update_common(map, *(u32 *)key, sops->sk,
-					      flags);
+	if (unlikely(!sock_map_op_okay(sops)))
+		return -EOPNOTSUPP;
+
+	sk = sock_map_ops_sk(sops->sk);
+	if (likely(sk && sock_map_sk_is_suitable(sk)))
+		return sock_map_update_common(map, *(u32 *)key, sk, flags);
 	return -EOPNOTSUPP;
 }
 
@@ -959,11 +982,16 @@ static void sock_hash_release_progs(struct bpf_map *map)
 BPF_CALL_4(bpf_sock_hash_update, struct bpf_sock_ops_kern *, sops,
 	   struct bpf_map *, map, void *, key, u64, flags)
 {
+	struct sock *sk;
+
 	WARN_ON_ONCE(!rcu_read_lock_held());
 
-	if (likely(sock_map_sk_is_suitable(sops->sk) &&
-		   sock_map_op_okay(sops)))
-		return sock_hash_update_common(map, key, sops->sk, flags);
+	if (unlikely(!sock_map_op_okay(sops)))
+		return -EOPNOTSUPP;
+
+	sk = sock_map_ops_sk(sops->sk);
+	if (likely(sk && sock_map_sk_is_suitable(sk)))
+		return sock_hash_update_common(map, key, sk, flags);
 	return -EOPNOTSUPP;
 }
 
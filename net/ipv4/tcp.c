@@ -822,13 +822,8 @@ ssize_t tcp_splice_read(struct socket *sock, loff_t *ppos,
 	lock_sock(sk);
 
 #ifdef CONFIG_MPTCP
-	if (mptcp(tcp_sk(sk))) {
-		struct mptcp_tcp_sock *mptcp;
-
-		mptcp_for_each_sub(tcp_sk(sk)->mpcb, mptcp) {
-			sock_rps_record_flow(mptcp_to_sock(mptcp));
-		}
-	}
+	if (mptcp(tcp_sk(sk)))
+		mptcp_record_flow(sk);
 #endif
 
 	timeo = sock_rcvtimeo(sk, sock->file->f_flags & O_NONBLOCK);
@@ -1028,24 +1023,16 @@ ssize_t do_tcp_sendpages(struct sock *sk, struct page *page, int offset,
 	}
 
 	if (mptcp(tp)) {
-		struct mptcp_tcp_sock *mptcp;
-
 		/* We must check this with socket-lock hold because we iterate
-		 * over the subflows.
+		 * over the subflows. Copy through sendmsg_locked rather than
+		 * sk_prot->sendmsg, as the latter is tcp_bpf_sendmsg when the
+		 * meta-socket is in a sockmap and would run the verdict again.
 		 */
-		if (!mptcp_can_sendpage(sk)) {
-			ssize_t ret;
+		if (!mptcp_can_sendpage(sk))
+			return sock_no_sendpage_locked(sk, page, offset, size,
+						       flags);
 
-			release_sock(sk);
-			ret = sock_no_sendpage(sk->sk_socket, page, offset,
-					       size, flags);
-			lock_sock(sk);
-			return ret;
-		}
-
-		mptcp_for_each_sub(tp->mpcb, mptcp) {
-			sock_rps_record_flow(mptcp_to_sock(mptcp));
-		}
+		mptcp_record_flow(sk);
 	}
 
 	sk_clear_bit(SOCKWQ_ASYNC_NOSPACE, sk);
@@ -1299,13 +1286,8 @@ int tcp_sendmsg_locked(struct sock *sk, struct msghdr *msg, size_t size)
 			goto do_error;
 	}
 
-	if (mptcp(tp)) {
-		struct mptcp_tcp_sock *mptcp;
-
-		mptcp_for_each_sub(tp->mpcb, mptcp) {
-			sock_rps_record_flow(mptcp_to_sock(mptcp));
-		}
-	}
+	if (mptcp(tp))
+		mptcp_record_flow(sk);
 
 	if (unlikely(tp->repair)) {
 		if (tp->repair_queue == TCP_RECV_QUEUE) {
@@ -1642,7 +1624,7 @@ void tcp_cleanup_rbuf(struct sock *sk, int copied)
 
 		/* Optimize, __tcp_select_window() is not cheap. */
 		if (2*rcv_window_now <= tp->window_clamp) {
-			__u32 new_window = tp->ops->__select_window(sk);
+			__u32 new_window = tcp_ops___select_window(sk);
 
 			/* Send ACK now, if this read freed lots of space
 			 * in our buffer. Certainly, new_window is new window.
@@ -1758,7 +1740,7 @@ int tcp_read_sock(struct sock *sk, read_descriptor_t *desc,
 	/* Clean up data we have read: This will do ACK frames. */
 	if (copied > 0) {
 		tcp_recv_skb(sk, seq, &offset);
-		tp->ops->cleanup_rbuf(sk, copied);
+		tcp_ops_cleanup_rbuf(sk, copied);
 	}
 	return copied;
 }
@@ -2050,13 +2032,8 @@ int tcp_recvmsg(struct sock *sk, struct msghdr *msg, size_t len, int nonblock,
 	lock_sock(sk);
 
 #ifdef CONFIG_MPTCP
-	if (mptcp(tp)) {
-		struct mptcp_tcp_sock *mptcp;
-
-		mptcp_for_each_sub(tp->mpcb, mptcp) {
-			sock_rps_record_flow(mptcp_to_sock(mptcp));
-		}
-	}
+	if (mptcp(tp))
+		mptcp_record_flow(sk);
 #endif
 
 	err = -ENOTCONN;
@@ -2177,7 +2154,7 @@ int tcp_recvmsg(struct sock *sk, struct msghdr *msg, size_t len, int nonblock,
 			}
 		}
 
-		tp->ops->cleanup_rbuf(sk, copied);
+		tcp_ops_cleanup_rbuf(sk, copied);
 
 		if (copied >= target) {
 			/* Do not sleep, just process backlog. */
@@ -2269,7 +2246,7 @@ int tcp_recvmsg(struct sock *sk, struct msghdr *msg, size_t len, int nonblock,
 	 */
 
 	/* Clean up data we have read: This will do ACK frames. */
-	tp->ops->cleanup_rbuf(sk, copied);
+	tcp_ops_cleanup_rbuf(sk, copied);
 
 	release_sock(sk);
 
@@ -2413,7 +2390,7 @@ void tcp_shutdown(struct sock *sk, int how)
 	     TCPF_SYN_RECV | TCPF_CLOSE_WAIT)) {
 		/* Clear out any half completed packets.  FIN if needed. */
 		if (tcp_close_state(sk))
-			tcp_sk(sk)->ops->send_fin(sk);
+			tcp_ops_send_fin(sk);
 	}
 }
 EXPORT_SYMBOL(tcp_shutdown);
@@ -3269,7 +3246,7 @@ static int do_tcp_setsockopt(struct sock *sk, int level,
 			    (TCPF_ESTABLISHED | TCPF_CLOSE_WAIT) &&
 			    inet_csk_ack_scheduled(sk)) {
 				icsk->icsk_ack.pending |= ICSK_ACK_PUSHED;
-				tp->ops->cleanup_rbuf(sk, 1);
+				tcp_ops_cleanup_rbuf(sk, 1);
 				if (!(val & 1))
 					inet_csk_enter_pingpong_mode(sk);
 			}
@@ -3363,6 +3340,17 @@ static int do_tcp_setsockopt(struct sock *sk, int level,
 
 		tp->record_master_info = !!(val & MPTCP_INFO_FLAG_SAVE_MASTER);
 		break;
+	case MPTCP_TARGET_RATE:
+		if (mptcp_init_failed || !sysctl_mptcp_enabled) {
+			err = -EPERM;
+			break;
+		}
+
+		if (val < 0)
+			err = -EINVAL;
+		else
+			tp->mptcp_target_rate = val;
+		break;
 #endif
 	case TCP_INQ:
 		if (val > 1 || val < 0)
@@ -3960,6 +3948,32 @@ static int do_tcp_getsockopt(struct sock *sk, int level,
 			return -EFAULT;
 		return 0;
 	}
+	case MPTCP_INFO_EXT:
+	{
+		int ret;
+
+		if (!mptcp(tp))
+			return -EINVAL;
+
+		if (get_user(len, optlen))
+			return -EFAULT;
+
+		len = min_t(unsigned int, len, sizeof(struct mptcp_info_ext));
+
+		lock_sock(sk);
+		ret = mptcp_get_info_ext(sk, optval, len);
+		release_sock(sk);
+
+		if (ret)
+			return ret;
+
+		if (put_user(len, optlen))
+			return -EFAULT;
+		return 0;
+	}
+	case MPTCP_TARGET_RATE:
+		val = tp->mptcp_target_rate;
+		break;
 #endif
 #ifdef CONFIG_MMU
 	case TCP_ZEROCOPY_RECEIVE: {
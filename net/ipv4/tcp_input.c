@@ -2969,7 +2969,7 @@ static bool tcp_ack_update_rtt(struct sock *sk, const int flag,
 	 */
 	tcp_update_rtt_min(sk, ca_rtt_us, flag);
 	tcp_rtt_estimator(sk, seq_rtt_us);
-	tp->ops->set_rto(sk);
+	tcp_ops_set_rto(sk);
 
 	/* RFC6298: only reset backoff on valid RTT measurement. */
 	inet_csk(sk)->icsk_backoff = 0;
@@ -5296,7 +5296,7 @@ static void tcp_new_space(struct sock *sk)
 {
 	struct tcp_sock *tp = tcp_sk(sk);
 
-	if (tp->ops->should_expand_sndbuf(sk)) {
+	if (tcp_ops_should_expand_sndbuf(sk)) {
 		tcp_sndbuf_expand(sk);
 		tp->snd_cwnd_stamp = tcp_jiffies32;
 	}
@@ -5344,7 +5344,7 @@ static void __tcp_ack_snd_check(struct sock *sk, int ofo_possible)
 	      * we have not received enough bytes to satisfy the condition.
 	      */
 	    (meta_tp->rcv_nxt - meta_tp->copied_seq < meta_sk->sk_rcvlowat ||
-	     tp->ops->__select_window(sk) >= tp->rcv_wnd)) ||
+	     tcp_ops___select_window(sk) >= tp->rcv_wnd)) ||
 	    /* We ACK each frame or... */
 	    tcp_in_quickack_mode(sk) ||
 	    /* Protocol state mandates a one-time immediate ACK */
@@ -566,7 +566,7 @@ int tcp_v4_err(struct sk_buff *icmp_skb, u32 info)
 		} else {
 			/* RTO revert clocked out retransmission.
 			 * Will retransmit now */
-			tcp_sk(sk)->ops->retransmit_timer(sk);
+			tcp_ops_retransmit_timer(sk);
 		}
 
 		break;
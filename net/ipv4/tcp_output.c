@@ -267,7 +267,7 @@ u16 tcp_select_window(struct sock *sk)
 	 * for the current meta-level sk_rcvbuf.
 	 */
 	u32 cur_win = tcp_receive_window_now(mptcp(tp) ? tcp_sk(mptcp_meta_sk(sk)) : tp);
-	u32 new_win = tp->ops->__select_window(sk);
+	u32 new_win = tcp_ops___select_window(sk);
 
 	/* Never shrink the offered window */
 	if (new_win < cur_win) {
@@ -814,8 +814,8 @@ static void tcp_tsq_write(struct sock *sk)
 			tcp_xmit_retransmit_queue(sk);
 		}
 
-		tcp_sk(sk)->ops->write_xmit(sk, tcp_current_mss(sk),
-					    tcp_sk(sk)->nonagle, 0, GFP_ATOMIC);
+		tcp_ops_write_xmit(sk, tcp_current_mss(sk),
+				   tcp_sk(sk)->nonagle, 0, GFP_ATOMIC);
 	}
 }
 
@@ -1167,7 +1167,7 @@ static int __tcp_transmit_skb(struct sock *sk, struct sk_buff *skb,
 	tcp_options_write((__be32 *)(th + 1), tp, &opts, skb);
 	skb_shinfo(skb)->gso_type = sk->sk_gso_type;
 	if (likely(!(tcb->tcp_flags & TCPHDR_SYN))) {
-		th->window	= htons(tp->ops->select_window(sk));
+		th->window	= htons(tcp_ops_select_window(sk));
 		tcp_ecn_send(sk, skb, th, tcp_header_size);
 	} else {
 		/* RFC1323: The window in SYN & SYN/ACK segments
@@ -2624,7 +2624,7 @@ void tcp_send_loss_probe(struct sock *sk)
 	skb = tcp_send_head(sk);
 	if (skb && tcp_snd_wnd_test(tp, skb, mss)) {
 		pcount = tp->packets_out;
-		tp->ops->write_xmit(sk, mss, TCP_NAGLE_OFF, 2, GFP_ATOMIC);
+		tcp_ops_write_xmit(sk, mss, TCP_NAGLE_OFF, 2, GFP_ATOMIC);
 		if (tp->packets_out > pcount)
 			goto probe_sent;
 		goto rearm_timer;
@@ -2686,8 +2686,8 @@ void __tcp_push_pending_frames(struct sock *sk, unsigned int cur_mss,
 	if (unlikely(sk->sk_state == TCP_CLOSE))
 		return;
 
-	if (tcp_sk(sk)->ops->write_xmit(sk, cur_mss, nonagle, 0,
-					sk_gfp_mask(sk, GFP_ATOMIC)))
+	if (tcp_ops_write_xmit(sk, cur_mss, nonagle, 0,
+			       sk_gfp_mask(sk, GFP_ATOMIC)))
 		tcp_check_probe_timer(sk);
 }
 
@@ -2700,8 +2700,7 @@ void tcp_push_one(struct sock *sk, unsigned int mss_now)
 
 	BUG_ON(!skb || skb->len < mss_now);
 
-	tcp_sk(sk)->ops->write_xmit(sk, mss_now, TCP_NAGLE_PUSH, 1,
-				    sk->sk_allocation);
+	tcp_ops_write_xmit(sk, mss_now, TCP_NAGLE_PUSH, 1, sk->sk_allocation);
 }
 
 /* This function returns the amount that we can raise the
@@ -3809,6 +3808,9 @@ void __tcp_send_ack(struct sock *sk, u32 rcv_nxt)
 
 	/* Send it off, this clears delayed acks for us. */
 	__tcp_transmit_skb(sk, buff, 0, (__force gfp_t)0, rcv_nxt);
+
+	if (mptcp(tcp_sk(sk)))
+		mptcp_account_pure_ack(sk);
 }
 EXPORT_SYMBOL_GPL(__tcp_send_ack);
 
@@ -3916,7 +3918,7 @@ void tcp_send_probe0(struct sock *sk)
 	unsigned long timeout;
 	int err;
 
-	err = tp->ops->write_wakeup(sk, LINUX_MIB_TCPWINPROBE);
+	err = tcp_ops_write_wakeup(sk, LINUX_MIB_TCPWINPROBE);
 
 	if (tp->packets_out || tcp_write_queue_empty(sk)) {
 		/* Cancel probe timer, if it is not required. */
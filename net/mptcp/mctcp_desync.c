@@ -10,9 +10,10 @@
  *  http://ieeexplore.ieee.org/abstract/document/6911722/
  *  https://doi.org/10.1016/j.comcom.2015.07.010
  *
- *  This prototype is for research purpose and is currently experimental code
- *  that only support a single path. Future support of multi-channel over
- *  multi-path requires channels grouping.
+ *  This prototype is for research purpose and is currently experimental code.
+ *  Channels are grouped by path (i.e., by local/remote address pair) and the
+ *  desynchronization is enforced within each group, as channels on different
+ *  paths do not share a bottleneck and thus do not synchronize their losses.
  *
  *  Initial Design and Implementation:
  *  Cheng Cui <Cheng.Cui@netapp.com>
@@ -31,13 +32,13 @@ enum {
 	INI_MIN_CWND = 2,
 };
 
-/* private congestion control structure:
- * off_tstamp: the last backoff timestamp for loss synchronization event
- * off_subfid: the subflow which was backoff on off_tstamp
+/* private congestion control structure, per channel. The last backoff
+ * for a loss synchronization event is kept in the mpcb (cc_off_tstamp and
+ * cc_off_path_index), as the other channels may run another CC:
+ * passed_init: our group backed off at least once
  */
 struct mctcp_desync {
-	u64	off_tstamp;
-	u8	off_subfid;
+	bool	passed_init;
 };
 
 static inline int mctcp_cc_sk_can_send(const struct sock *sk)
@@ -45,14 +46,72 @@ static inline int mctcp_cc_sk_can_send(const struct sock *sk)
 	return mptcp_sk_can_send(sk) && tcp_sk(sk)->srtt_us;
 }
 
+/* Are both channels on the same path? */
+static bool mctcp_same_group(const struct sock *sk, const struct sock *sub_sk)
+{
+	if (sk == sub_sk)
+		return true;
+
+	if (sk->sk_family != sub_sk->sk_family)
+		return false;
+
+	if (sk->sk_family == AF_INET)
+		return inet_sk(sk)->inet_saddr == inet_sk(sub_sk)->inet_saddr &&
+		       inet_sk(sk)->inet_daddr == inet_sk(sub_sk)->inet_daddr;
+#if IS_ENABLED(CONFIG_IPV6)
+	return ipv6_addr_equal(&sk->sk_v6_rcv_saddr, &sub_sk->sk_v6_rcv_saddr) &&
+	       ipv6_addr_equal(&sk->sk_v6_daddr, &sub_sk->sk_v6_daddr);
+#else
+	return false;
+#endif
+}
+
+/* The first channel of a group is the one with the lowest path-index */
+static bool mctcp_is_group_master(const struct sock *sk)
+{
+	const struct tcp_sock *tp = tcp_sk(sk);
+	const struct mptcp_tcp_sock *mptcp;
+
+	if (tp->mptcp->path_index == MASTER_CHANNEL)
+		return true;
+
+	mptcp_for_each_sub(tp->mpcb, mptcp) {
+		const struct sock *sub_sk = mptcp_to_sock(mptcp);
+
+		if (mptcp->path_index < tp->mptcp->path_index &&
+		    mptcp_sk_can_send(sub_sk) && mctcp_same_group(sk, sub_sk))
+			return false;
+	}
+
+	return true;
+}
+
+/* Was the last backoff of the connection in the group of sk? */
+static bool mctcp_group_backoff(const struct sock *sk)
+{
+	const struct mptcp_cb *mpcb = tcp_sk(sk)->mpcb;
+	const struct mptcp_tcp_sock *mptcp;
+
+	if (!mpcb->cc_off_path_index)
+		return false;
+
+	mptcp_for_each_sub(mpcb, mptcp) {
+		if (mptcp->path_index == mpcb->cc_off_path_index)
+			return mctcp_same_group(sk, mptcp_to_sock(mptcp));
+	}
+
+	return false;
+}
+
 static void mctcp_desync_init(struct sock *sk)
 {
 	if (mptcp(tcp_sk(sk))) {
-		struct mctcp_desync *ca = inet_csk_ca(mptcp_meta_sk(sk));
-		ca->off_tstamp = 0;
-		ca->off_subfid = 0;
-    }
-    /* If we do not mptcp, behave like reno: return */
+		struct mctcp_desync *ca = inet_csk_ca(sk);
+
+		/* Joining an existing group takes over its phase */
+		ca->passed_init = mctcp_group_backoff(sk);
+	}
+	/* If we do not mptcp, behave like reno: return */
 }
 
 static void mctcp_desync_cong_avoid(struct sock *sk, u32 ack, u32 acked)
@@ -65,22 +124,25 @@ static void mctcp_desync_cong_avoid(struct sock *sk, u32 ack, u32 acked)
 	} else if (!tcp_is_cwnd_limited(sk)) {
 		return;
 	} else {
-		const struct mctcp_desync *ca = inet_csk_ca(mptcp_meta_sk(sk));
+		struct mctcp_desync *ca = inet_csk_ca(sk);
 		const u8 subfid = tp->mptcp->path_index;
 
-		/* current aggregated cwnd */
+		/* current aggregated cwnd of the group */
 		u32 agg_cwnd = 0;
 		u32 min_cwnd = 0xffffffff;
 		u8 min_cwnd_subfid = 0;
 
 		/* In "safe" area, increase */
 		if (tcp_in_slow_start(tp)) {
-			if (ca->off_subfid) {
+			if (!ca->passed_init && mctcp_group_backoff(sk))
+				ca->passed_init = true;
+
+			if (ca->passed_init) {
 				/* passed initial phase, allow slow start */
 				tcp_slow_start(tp, acked);
-			} else if (MASTER_CHANNEL == tp->mptcp->path_index) {
-				/* master channel is normal slow start in
-				 * initial phase */
+			} else if (mctcp_is_group_master(sk)) {
+				/* master channel of the group is normal slow
+				 * start in initial phase */
 				tcp_slow_start(tp, acked);
 			} else {
 				/* secondary channels increase slowly until
@@ -93,11 +155,14 @@ static void mctcp_desync_cong_avoid(struct sock *sk, u32 ack, u32 acked)
 			/* In dangerous area, increase slowly and linearly. */
 			const struct mptcp_tcp_sock *mptcp;
 
-			/* get total cwnd and the subflow that has min cwnd */
+			/* get total cwnd and the subflow that has min cwnd,
+			 * within our group
+			 */
 			mptcp_for_each_sub(tp->mpcb, mptcp) {
 				const struct sock *sub_sk = mptcp_to_sock(mptcp);
 
-				if (mctcp_cc_sk_can_send(sub_sk)) {
+				if (mctcp_cc_sk_can_send(sub_sk) &&
+				    mctcp_same_group(sk, sub_sk)) {
 					const struct tcp_sock *sub_tp =
 								tcp_sk(sub_sk);
 					agg_cwnd += sub_tp->snd_cwnd;
@@ -126,17 +191,19 @@ static u32 mctcp_desync_ssthresh(struct sock *sk)
 	if (!mptcp(tp)) {
 		return max(tp->snd_cwnd >> 1U, 2U);
 	} else {
-		struct mctcp_desync *ca = inet_csk_ca(mptcp_meta_sk(sk));
+		struct mctcp_desync *ca = inet_csk_ca(sk);
 		const u8 subfid = tp->mptcp->path_index;
+		struct mptcp_cb *mpcb = tp->mpcb;
 		const struct mptcp_tcp_sock *mptcp;
 		u32 max_cwnd = 0;
 		u8 max_cwnd_subfid = 0;
 
-		/* Find the subflow that has the max cwnd. */
+		/* Find the subflow of our group that has the max cwnd. */
 		mptcp_for_each_sub(tp->mpcb, mptcp) {
 			const struct sock *sub_sk = mptcp_to_sock(mptcp);
 
-			if (mctcp_cc_sk_can_send(sub_sk)) {
+			if (mctcp_cc_sk_can_send(sub_sk) &&
+			    mctcp_same_group(sk, sub_sk)) {
 				const struct tcp_sock *sub_tp = tcp_sk(sub_sk);
 				if (max_cwnd < sub_tp->snd_cwnd) {
 					max_cwnd = sub_tp->snd_cwnd;
@@ -148,14 +215,17 @@ static u32 mctcp_desync_ssthresh(struct sock *sk)
 		/* Use high resolution clock. */
 		if (subfid == max_cwnd_subfid) {
 			u64 now = tcp_clock_us();
-			u32 delta = tcp_stamp_us_delta(now, ca->off_tstamp);
 
-			if (delta < (tp->srtt_us >> 3)) {
+			if (mctcp_group_backoff(sk) &&
+			    tcp_stamp_us_delta(now, mpcb->cc_off_tstamp) <
+			    (tp->srtt_us >> 3)) {
 				/* desynchronize */
 				return tp->snd_cwnd;
 			} else {
-				ca->off_tstamp = now;
-				ca->off_subfid = subfid;
+				/* The backoff is seen by the whole group */
+				mpcb->cc_off_tstamp = now;
+				mpcb->cc_off_path_index = subfid;
+				ca->passed_init = true;
 				return max(max_cwnd >> 1U, 2U);
 			}
 		} else {
@@ -92,7 +92,8 @@ static void mptcp_balia_recalc_ai(const struct sock *sk)
 		struct tcp_sock *sub_tp = tcp_sk(sub_sk);
 		u64 tmp;
 
-		if (!mptcp_balia_sk_can_send(sub_sk))
+		if (!mptcp_balia_sk_can_send(sub_sk) ||
+		    !mptcp_sbd_coupled(sk, sub_sk))
 			continue;
 
 		tmp = div_u64((u64)tp->mss_cache * sub_tp->snd_cwnd
@@ -125,7 +126,8 @@ static void mptcp_balia_recalc_ai(const struct sock *sk)
 			struct tcp_sock *sub_tp = tcp_sk(sub_sk);
 			u64 tmp;
 
-			if (!mptcp_balia_sk_can_send(sub_sk))
+			if (!mptcp_balia_sk_can_send(sub_sk) ||
+			    !mptcp_sbd_coupled(sk, sub_sk))
 				continue;
 
 			tmp = div_u64((u64)tp->mss_cache * sub_tp->snd_cwnd
@@ -236,6 +238,7 @@ static struct tcp_congestion_ops mptcp_balia = {
 	.cong_avoid	= mptcp_balia_cong_avoid,
 	.undo_cwnd	= tcp_reno_undo_cwnd,
 	.cwnd_event	= mptcp_balia_cwnd_event,
+	.pkts_acked	= mptcp_sbd_pkts_acked,
 	.set_state	= mptcp_balia_set_state,
 	.owner		= THIS_MODULE,
 	.name		= "balia",
@@ -0,0 +1,445 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ *	MPTCP implementation - Coupled BBR congestion control
+ *
+ *	Every subflow keeps its own BBR-model of the path (max-filtered
+ *	delivery-rate and min_rtt) and goes through the BBR-states (startup,
+ *	drain, probe_bw and probe_rtt) on its own.
+ *
+ *	The subflows that are coupled (all of them, or those sharing a
+ *	bottleneck if mptcp_sbd is enabled) share the rate of the best one
+ *	among them: subflow i paces at
+ *
+ *		bw_i * max_j(bw_j) / sum_j(bw_j)
+ *
+ *	Thus, together, they are not more aggressive than a single BBR-flow
+ *	on the best path (RFC 6356, goals 1 and 2), while moving traffic to
+ *	the paths with the highest delivery-rate (goal 3).
+ *
+ *	This program is free software; you can redistribute it and/or
+ *      modify it under the terms of the GNU General Public License
+ *      as published by the Free Software Foundation; either version
+ *      2 of the License, or (at your option) any later version.
+ */
+
+#include <linux/module.h>
+#include <linux/win_minmax.h>
+#include <net/mptcp.h>
+#include <net/tcp.h>
+
+/* Scale of the bandwidth (in packets per usec) */
+#define MPBBR_BW_SCALE		24
+#define MPBBR_BW_UNIT		(1 << MPBBR_BW_SCALE)
+
+/* Scale of the gains */
+#define MPBBR_SCALE		8
+#define MPBBR_UNIT		(1 << MPBBR_SCALE)
+
+/* Window of the max-filter of the bandwidth, in rounds */
+#define MPBBR_BW_RTTS		10
+/* Window of the min-filter of the RTT, in seconds */
+#define MPBBR_MIN_RTT_WIN_SEC	10
+/* Time spent in probe_rtt, in ms */
+#define MPBBR_PROBE_RTT_MS	200
+#define MPBBR_MIN_CWND		4
+/* Number of rounds without a 25% bw-increase, to leave startup */
+#define MPBBR_FULL_BW_CNT	3
+#define MPBBR_PACING_MARGIN	1	/* in percent */
+
+enum mpbbr_mode {
+	MPBBR_STARTUP,
+	MPBBR_DRAIN,
+	MPBBR_PROBE_BW,
+	MPBBR_PROBE_RTT,
+};
+
+/* 2/ln(2) for startup, its inverse for drain */
+static const int mpbbr_high_gain = MPBBR_UNIT * 2885 / 1000 + 1;
+static const int mpbbr_drain_gain = MPBBR_UNIT * 1000 / 2885;
+static const int mpbbr_cwnd_gain = MPBBR_UNIT * 2;
+
+#define MPBBR_CYCLE_LEN		8
+static const int mpbbr_pacing_gain[MPBBR_CYCLE_LEN] = {
+	MPBBR_UNIT * 5 / 4, MPBBR_UNIT * 3 / 4,
+	MPBBR_UNIT, MPBBR_UNIT, MPBBR_UNIT,
+	MPBBR_UNIT, MPBBR_UNIT, MPBBR_UNIT,
+};
+
+struct mpbbr {
+	struct minmax	bw;		/* Max-filtered delivery-rate */
+	u64	cycle_mstamp;		/* Start of the current gain-cycle */
+	u32	min_rtt_us;
+	u32	min_rtt_stamp;		/* jiffies of the min_rtt_us sample */
+	u32	probe_rtt_done_stamp;
+	u32	next_rtt_delivered;	/* tp->delivered at the end of round */
+	u32	rtt_cnt;		/* Number of rounds so far */
+	u32	full_bw;		/* Bandwidth at the last 25%-increase */
+	u32	coupled_bw;		/* Our share of the best bandwidth */
+	u32	prior_cwnd;		/* cwnd before loss-recovery/probe_rtt */
+	u8	mode;
+	u8	cycle_idx;
+	u8	full_bw_cnt;
+	u8	round_start:1,
+		full_bw_reached:1,
+		packet_conservation:1,
+		prev_ca_state:3;
+};
+
+static u32 mpbbr_max_bw(const struct sock *sk)
+{
+	const struct mpbbr *ca = inet_csk_ca(sk);
+
+	return minmax_get(&ca->bw);
+}
+
+/* Recomputes our share, bw * max_bw / sum_bw, among the coupled subflows */
+static void mpbbr_update_coupling(struct sock *sk)
+{
+	struct mpbbr *ca = inet_csk_ca(sk);
+	const struct mptcp_tcp_sock *mptcp;
+	u64 sum_bw = 0, max_bw = 0, bw = mpbbr_max_bw(sk);
+
+	if (!mptcp(tcp_sk(sk)) || !bw) {
+		ca->coupled_bw = bw;
+		return;
+	}
+
+	mptcp_for_each_sub(tcp_sk(sk)->mpcb, mptcp) {
+		const struct sock *sub_sk = mptcp_to_sock(mptcp);
+		u64 sub_bw;
+
+		if (!mptcp_sk_can_send(sub_sk) || !mptcp_sbd_coupled(sk, sub_sk))
+			continue;
+
+		/* Subflows in slow-start are not (yet) competing with us */
+		if (sub_sk != sk &&
+		    !((struct mpbbr *)inet_csk_ca(sub_sk))->full_bw_reached)
+			continue;
+
+		sub_bw = mpbbr_max_bw(sub_sk);
+		sum_bw += sub_bw;
+		max_bw = max(max_bw, sub_bw);
+	}
+
+	ca->coupled_bw = sum_bw ? div64_u64(bw * max_bw, sum_bw) : bw;
+}
+
+static u64 mpbbr_rate_bytes_per_sec(const struct sock *sk, u64 rate, int gain)
+{
+	rate *= tcp_sk(sk)->mss_cache;
+	rate *= gain;
+	rate >>= MPBBR_SCALE;
+	rate *= USEC_PER_SEC / 100 * (100 - MPBBR_PACING_MARGIN);
+	return rate >> MPBBR_BW_SCALE;
+}
+
+static int mpbbr_pacing_gain_now(const struct mpbbr *ca)
+{
+	switch (ca->mode) {
+	case MPBBR_STARTUP:
+		return mpbbr_high_gain;
+	case MPBBR_DRAIN:
+		return mpbbr_drain_gain;
+	case MPBBR_PROBE_BW:
+		return mpbbr_pacing_gain[ca->cycle_idx];
+	default:
+		return MPBBR_UNIT;
+	}
+}
+
+static void mpbbr_set_pacing_rate(struct sock *sk)
+{
+	const struct tcp_sock *tp = tcp_sk(sk);
+	const struct mpbbr *ca = inet_csk_ca(sk);
+	u64 rate;
+
+	if (ca->coupled_bw) {
+		rate = mpbbr_rate_bytes_per_sec(sk, ca->coupled_bw,
+						mpbbr_pacing_gain_now(ca));
+	} else {
+		/* No sample yet: high_gain * cwnd / RTT */
+		u32 rtt_us = tp->srtt_us ? max(tp->srtt_us >> 3, 1U) :
+					   USEC_PER_MSEC;
+
+		rate = div_u64((u64)tp->snd_cwnd * MPBBR_BW_UNIT, rtt_us);
+		rate = mpbbr_rate_bytes_per_sec(sk, rate, mpbbr_high_gain);
+	}
+	rate = min_t(u64, rate, sk->sk_max_pacing_rate);
+
+	if (ca->full_bw_reached || rate > sk->sk_pacing_rate)
+		sk->sk_pacing_rate = rate;
+}
+
+/* BDP of our share, in packets, with a gain */
+static u32 mpbbr_bdp(const struct sock *sk, int gain)
+{
+	const struct mpbbr *ca = inet_csk_ca(sk);
+	u64 bdp;
+
+	if (unlikely(ca->min_rtt_us == ~0U || !ca->coupled_bw))
+		return TCP_INIT_CWND;
+
+	bdp = (u64)ca->coupled_bw * ca->min_rtt_us;
+	bdp = ((bdp * gain) >> MPBBR_SCALE) + MPBBR_BW_UNIT - 1;
+	return max_t(u32, bdp >> MPBBR_BW_SCALE, MPBBR_MIN_CWND);
+}
+
+/* Segments per TSO-burst at the current pacing-rate, as in tcp_tso_autosize */
+static u32 mpbbr_tso_segs(const struct sock *sk)
+{
+	u32 segs;
+
+	segs = (sk->sk_pacing_rate >> sk->sk_pacing_shift) /
+	       max(tcp_sk(sk)->mss_cache, 1U);
+	segs = min_t(u32, segs, sk->sk_gso_max_segs);
+
+	return max_t(u32, segs, 2);
+}
+
+static void mpbbr_update_bw(struct sock *sk, const struct rate_sample *rs)
+{
+	struct tcp_sock *tp = tcp_sk(sk);
+	struct mpbbr *ca = inet_csk_ca(sk);
+	u64 bw;
+
+	ca->round_start = 0;
+	if (rs->delivered < 0 || rs->interval_us <= 0)
+		return;
+
+	if (!before(rs->prior_delivered, ca->next_rtt_delivered)) {
+		ca->next_rtt_delivered = tp->delivered;
+		ca->rtt_cnt++;
+		ca->round_start = 1;
+		ca->packet_conservation = 0;
+	}
+
+	bw = div64_long((u64)rs->delivered * MPBBR_BW_UNIT, rs->interval_us);
+
+	/* App-limited samples only count if they are above the estimate */
+	if (!rs->is_app_limited || bw >= mpbbr_max_bw(sk))
+		minmax_running_max(&ca->bw, MPBBR_BW_RTTS, ca->rtt_cnt, bw);
+}
+
+static void mpbbr_check_full_bw_reached(struct sock *sk,
+					const struct rate_sample *rs)
+{
+	struct mpbbr *ca = inet_csk_ca(sk);
+	u32 bw_thresh;
+
+	if (ca->full_bw_reached || !ca->round_start || rs->is_app_limited)
+		return;
+
+	bw_thresh = (u64)ca->full_bw * 5 / 4;
+	if (mpbbr_max_bw(sk) >= bw_thresh) {
+		ca->full_bw = mpbbr_max_bw(sk);
+		ca->full_bw_cnt = 0;
+		return;
+	}
+
+	if (++ca->full_bw_cnt >= MPBBR_FULL_BW_CNT)
+		ca->full_bw_reached = 1;
+}
+
+static void mpbbr_update_mode(struct sock *sk, const struct rate_sample *rs)
+{
+	struct tcp_sock *tp = tcp_sk(sk);
+	struct mpbbr *ca = inet_csk_ca(sk);
+	bool expired;
+
+	if (ca->mode == MPBBR_STARTUP && ca->full_bw_reached)
+		ca->mode = MPBBR_DRAIN;
+
+	if (ca->mode == MPBBR_DRAIN &&
+	    tcp_packets_in_flight(tp) <= mpbbr_bdp(sk, MPBBR_UNIT)) {
+		ca->mode = MPBBR_PROBE_BW;
+		ca->cycle_idx = prandom_u32_max(MPBBR_CYCLE_LEN - 1) + 1;
+		ca->cycle_mstamp = tp->delivered_mstamp;
+	}
+
+	/* Advance the gain-cycle every min_rtt */
+	if (ca->mode == MPBBR_PROBE_BW &&
+	    tcp_stamp_us_delta(tp->delivered_mstamp, ca->cycle_mstamp) >
+	    ca->min_rtt_us) {
+		ca->cycle_idx = (ca->cycle_idx + 1) % MPBBR_CYCLE_LEN;
+		ca->cycle_mstamp = tp->delivered_mstamp;
+	}
+
+	expired = after(tcp_jiffies32, ca->min_rtt_stamp +
+			MPBBR_MIN_RTT_WIN_SEC * HZ);
+	if (rs->rtt_us >= 0 &&
+	    (rs->rtt_us < ca->min_rtt_us || (expired && !rs->is_ack_delayed))) {
+		ca->min_rtt_us = rs->rtt_us;
+		ca->min_rtt_stamp = tcp_jiffies32;
+	}
+
+	if (expired && ca->mode != MPBBR_PROBE_RTT) {
+		ca->mode = MPBBR_PROBE_RTT;
+		ca->prior_cwnd = max(ca->prior_cwnd, tp->snd_cwnd);
+		ca->probe_rtt_done_stamp = 0;
+	}
+
+	if (ca->mode == MPBBR_PROBE_RTT) {
+		if (!ca->probe_rtt_done_stamp &&
+		    tcp_packets_in_flight(tp) <= MPBBR_MIN_CWND) {
+			ca->probe_rtt_done_stamp = tcp_jiffies32 +
+				msecs_to_jiffies(MPBBR_PROBE_RTT_MS);
+		} else if (ca->probe_rtt_done_stamp &&
+			   after(tcp_jiffies32, ca->probe_rtt_done_stamp)) {
+			ca->min_rtt_stamp = tcp_jiffies32;
+			tp->snd_cwnd = max(tp->snd_cwnd, ca->prior_cwnd);
+			ca->prior_cwnd = 0;
+			ca->mode = ca->full_bw_reached ? MPBBR_PROBE_BW :
+							 MPBBR_STARTUP;
+			ca->cycle_mstamp = tp->delivered_mstamp;
+		}
+	}
+}
+
+static void mpbbr_set_cwnd(struct sock *sk, const struct rate_sample *rs)
+{
+	struct tcp_sock *tp = tcp_sk(sk);
+	struct mpbbr *ca = inet_csk_ca(sk);
+	u8 state = inet_csk(sk)->icsk_ca_state;
+	u32 cwnd = tp->snd_cwnd, target;
+
+	if (!rs->acked_sacked)
+		goto done;
+
+	if (rs->losses > 0)
+		cwnd = max_t(s32, cwnd - rs->losses, 1);
+
+	/* Packet-conservation during the first round of recovery */
+	if (state == TCP_CA_Recovery && ca->prev_ca_state != TCP_CA_Recovery) {
+		ca->packet_conservation = 1;
+		ca->next_rtt_delivered = tp->delivered;
+		cwnd = tcp_packets_in_flight(tp) + rs->acked_sacked;
+	} else if (state < TCP_CA_Recovery &&
+		   ca->prev_ca_state >= TCP_CA_Recovery) {
+		cwnd = max(cwnd, ca->prior_cwnd);
+		ca->packet_conservation = 0;
+	}
+	ca->prev_ca_state = state;
+
+	if (ca->packet_conservation) {
+		cwnd = max(cwnd, tcp_packets_in_flight(tp) + rs->acked_sacked);
+		goto done;
+	}
+
+	/* Leave room for the TSO/GSO-bursts of the pacing-layer */
+	target = mpbbr_bdp(sk, mpbbr_cwnd_gain) + 3 * mpbbr_tso_segs(sk);
+
+	if (ca->full_bw_reached)
+		cwnd = min(cwnd + rs->acked_sacked, target);
+	else if (cwnd < target || tp->delivered < TCP_INIT_CWND)
+		cwnd = cwnd + rs->acked_sacked;
+	cwnd = max_t(u32, cwnd, MPBBR_MIN_CWND);
+
+done:
+	tp->snd_cwnd = min(cwnd, tp->snd_cwnd_clamp);
+	if (ca->mode == MPBBR_PROBE_RTT)
+		tp->snd_cwnd = min_t(u32, tp->snd_cwnd, MPBBR_MIN_CWND);
+}
+
+static void mpbbr_main(struct sock *sk, const struct rate_sample *rs)
+{
+	struct mpbbr *ca = inet_csk_ca(sk);
+
+	mpbbr_update_bw(sk, rs);
+	mpbbr_check_full_bw_reached(sk, rs);
+	mpbbr_update_mode(sk, rs);
+
+	/* The other subflows' models only change once per round, as ours */
+	if (ca->round_start || !ca->coupled_bw)
+		mpbbr_update_coupling(sk);
+
+	mpbbr_set_pacing_rate(sk);
+	mpbbr_set_cwnd(sk, rs);
+}
+
+static void mpbbr_init(struct sock *sk)
+{
+	struct tcp_sock *tp = tcp_sk(sk);
+	struct mpbbr *ca = inet_csk_ca(sk);
+
+	memset(ca, 0, sizeof(*ca));
+	ca->min_rtt_us = tcp_min_rtt(tp);
+	ca->min_rtt_stamp = tcp_jiffies32;
+	ca->next_rtt_delivered = tp->delivered;
+	ca->mode = MPBBR_STARTUP;
+	minmax_reset(&ca->bw, ca->rtt_cnt, 0);
+
+	mpbbr_set_pacing_rate(sk);
+
+	cmpxchg(&sk->sk_pacing_status, SK_PACING_NONE, SK_PACING_NEEDED);
+}
+
+static u32 mpbbr_undo_cwnd(struct sock *sk)
+{
+	struct mpbbr *ca = inet_csk_ca(sk);
+
+	ca->full_bw = 0;
+	ca->full_bw_cnt = 0;
+	return tcp_sk(sk)->snd_cwnd;
+}
+
+static u32 mpbbr_ssthresh(struct sock *sk)
+{
+	struct mpbbr *ca = inet_csk_ca(sk);
+
+	ca->prior_cwnd = tcp_sk(sk)->snd_cwnd;
+	return tcp_sk(sk)->snd_ssthresh;
+}
+
+static void mpbbr_set_state(struct sock *sk, u8 new_state)
+{
+	struct mpbbr *ca = inet_csk_ca(sk);
+
+	if (new_state == TCP_CA_Loss) {
+		ca->prev_ca_state = TCP_CA_Loss;
+		ca->full_bw = 0;
+		ca->round_start = 1;
+	}
+}
+
+static void mpbbr_cwnd_event(struct sock *sk, enum tcp_ca_event event)
+{
+	struct mpbbr *ca = inet_csk_ca(sk);
+
+	/* Restarting after idle - don't probe for more right away */
+	if (event == CA_EVENT_TX_START && tcp_sk(sk)->app_limited &&
+	    ca->mode == MPBBR_PROBE_BW) {
+		ca->cycle_idx = 2;
+		ca->cycle_mstamp = tcp_sk(sk)->tcp_mstamp;
+	}
+}
+
+static struct tcp_congestion_ops mptcp_bbr __read_mostly = {
+	.flags		= TCP_CONG_NON_RESTRICTED,
+	.init		= mpbbr_init,
+	.cong_control	= mpbbr_main,
+	.ssthresh	= mpbbr_ssthresh,
+	.undo_cwnd	= mpbbr_undo_cwnd,
+	.cwnd_event	= mpbbr_cwnd_event,
+	.set_state	= mpbbr_set_state,
+	.pkts_acked	= mptcp_sbd_pkts_acked,
+	.owner		= THIS_MODULE,
+	.name		= "mpbbr",
+};
+
+static int __init mptcp_bbr_register(void)
+{
+	BUILD_BUG_ON(sizeof(struct mpbbr) > ICSK_CA_PRIV_SIZE);
+	return tcp_register_congestion_control(&mptcp_bbr);
+}
+
+static void __exit mptcp_bbr_unregister(void)
+{
+	tcp_unregister_congestion_control(&mptcp_bbr);
+}
+
+module_init(mptcp_bbr_register);
+module_exit(mptcp_bbr_unregister);
+
+MODULE_LICENSE("GPL");
+MODULE_DESCRIPTION("MPTCP COUPLED BBR CONGESTION CONTROL");
+MODULE_VERSION("0.1");
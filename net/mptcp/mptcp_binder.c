@@ -2,6 +2,7 @@
 
 #include <net/mptcp.h>
 #include <net/mptcp_v4.h>
+#include <net/mptcp_v6.h>
 
 #include <linux/route.h>
 #include <linux/inet.h>
@@ -17,10 +18,14 @@
 #define MPTCP_GW_LIST_MAX_LEN	6
 #define MPTCP_GW_SYSCTL_MAX_LEN	(15 * MPTCP_GW_LIST_MAX_LEN *	\
 							MPTCP_GW_MAX_LISTS)
+#define MPTCP_SEG_SYSCTL_MAX_LEN	(INET6_ADDRSTRLEN * MPTCP_GW_LIST_MAX_LEN * \
+					 MPTCP_GW_MAX_LISTS)
 
+/* Lists of IPv4 gateways (LSRR) or of IPv6 segments (SRH) */
 struct mptcp_gw_list {
-	struct in_addr list[MPTCP_GW_MAX_LISTS][MPTCP_GW_LIST_MAX_LEN];
+	union inet_addr list[MPTCP_GW_MAX_LISTS][MPTCP_GW_LIST_MAX_LEN];
 	u8 len[MPTCP_GW_MAX_LISTS];
+	u8 count; /* Number of lists */
 };
 
 struct binder_priv {
@@ -29,118 +34,54 @@ struct binder_priv {
 
 	struct mptcp_cb *mpcb;
 
-	/* Prevent multiple sub-sockets concurrently iterating over sockets */
-	spinlock_t *flow_lock;
+	/* Path-index of the subflow that took a list, 0 if the list is free.
+	 * Only valid as long as list_gen matches mptcp_gws_gen. Protected by
+	 * the meta-socket lock.
+	 */
+	u8 list_owner[MPTCP_GW_MAX_LISTS];
+	u32 list_gen;
 };
 
 static struct mptcp_gw_list *mptcp_gws;
+static struct mptcp_gw_list *mptcp_segs;
 static rwlock_t mptcp_gws_lock;
-
-static int mptcp_binder_ndiffports __read_mostly = 1;
+/* Bumped whenever the lists change, so that connections forget the lists
+ * their subflows took.
+ */
+static u32 mptcp_gws_gen;
 
 static char sysctl_mptcp_binder_gateways[MPTCP_GW_SYSCTL_MAX_LEN] __read_mostly;
+static char sysctl_mptcp_binder_segments[MPTCP_SEG_SYSCTL_MAX_LEN] __read_mostly;
 
-static int mptcp_get_avail_list_ipv4(struct sock *sk)
+/* Returns the first list that is not yet used by a subflow of this
+ * connection, or -1 if there is none. Must be called with mptcp_gws_lock held.
+ */
+static int mptcp_get_avail_list(struct binder_priv *fmp,
+				const struct mptcp_gw_list *gws)
 {
-	int i, j, list_taken, opt_ret, opt_len;
-	unsigned char *opt_ptr, *opt_end_ptr, opt[MAX_IPOPTLEN];
-
-	for (i = 0; i < MPTCP_GW_MAX_LISTS; ++i) {
-		struct mptcp_tcp_sock *mptcp;
-
-		if (mptcp_gws->len[i] == 0)
-			goto error;
-
-		mptcp_debug("mptcp_get_avail_list_ipv4: List %i\n", i);
-		list_taken = 0;
-
-		/* Loop through all sub-sockets in this connection */
-		mptcp_for_each_sub(tcp_sk(sk)->mpcb, mptcp) {
-			sk = mptcp_to_sock(mptcp);
-
-			mptcp_debug("mptcp_get_avail_list_ipv4: Next sock\n");
-
-			/* Reset length and options buffer, then retrieve
-			 * from socket
-			 */
-			opt_len = MAX_IPOPTLEN;
-			memset(opt, 0, MAX_IPOPTLEN);
-			opt_ret = ip_getsockopt(sk, IPPROTO_IP,
-				IP_OPTIONS, (char __user *)opt, (int __user *)&opt_len);
-			if (opt_ret < 0) {
-				mptcp_debug("%s: MPTCP subsocket getsockopt() IP_OPTIONS failed, error %d\n",
-					    __func__, opt_ret);
-				goto error;
-			}
-
-			/* If socket has no options, it has no stake in this list */
-			if (opt_len <= 0)
-				continue;
-
-			/* Iterate options buffer */
-			for (opt_ptr = &opt[0]; opt_ptr < &opt[opt_len]; opt_ptr++) {
-				if (*opt_ptr == IPOPT_LSRR) {
-					mptcp_debug("mptcp_get_avail_list_ipv4: LSRR options found\n");
-					goto sock_lsrr;
-				}
-			}
-			continue;
-
-sock_lsrr:
-			/* Pointer to the 2nd to last address */
-			opt_end_ptr = opt_ptr+(*(opt_ptr+1))-4;
-
-			/* Addresses start 3 bytes after type offset */
-			opt_ptr += 3;
-			j = 0;
-
-			/* Different length lists cannot be the same */
-			if ((opt_end_ptr-opt_ptr)/4 != mptcp_gws->len[i])
-				continue;
+	int i;
 
-			/* Iterate if we are still inside options list
-			 * and sysctl list
-			 */
-			while (opt_ptr < opt_end_ptr && j < mptcp_gws->len[i]) {
-				/* If there is a different address, this list must
-				 * not be set on this socket
-				 */
-				if (memcmp(&mptcp_gws->list[i][j], opt_ptr, 4))
-					break;
-
-				/* Jump 4 bytes to next address */
-				opt_ptr += 4;
-				j++;
-			}
-
-			/* Reached the end without a differing address, lists
-			 * are therefore identical.
-			 */
-			if (j == mptcp_gws->len[i]) {
-				mptcp_debug("mptcp_get_avail_list_ipv4: List already used\n");
-				list_taken = 1;
-				break;
-			}
-		}
+	if (fmp->list_gen != mptcp_gws_gen) {
+		memset(fmp->list_owner, 0, sizeof(fmp->list_owner));
+		fmp->list_gen = mptcp_gws_gen;
+	}
 
-		/* Free list found if not taken by a socket */
-		if (!list_taken) {
-			mptcp_debug("mptcp_get_avail_list_ipv4: List free\n");
+	for (i = 0; i < MPTCP_GW_MAX_LISTS; ++i) {
+		if (gws->len[i] == 0)
 			break;
+
+		if (!fmp->list_owner[i]) {
+			mptcp_debug("%s: List %i free\n", __func__, i);
+			return i;
 		}
 	}
 
-	if (i >= MPTCP_GW_MAX_LISTS)
-		goto error;
-
-	return i;
-error:
 	return -1;
 }
 
-/* The list of addresses is parsed each time a new connection is opened,
- *  to make sure it's up to date. In case of error, all the lists are
- *  marked as unavailable and the subflow's fingerprint is set to 0.
+/* The free list is looked up each time a new subflow is created, to make
+ * sure it's up to date. The list is taken by the subflow only if the option
+ * could be set.
  */
 static void mptcp_v4_add_lsrr(struct sock *sk, struct in_addr addr)
 {
@@ -150,69 +91,127 @@ static void mptcp_v4_add_lsrr(struct sock *sk, struct in_addr addr)
 	struct binder_priv *fmp = (struct binder_priv *)&tp->mpcb->mptcp_pm[0];
 
 	/* Read lock: multiple sockets can read LSRR addresses at the same
-	 * time, but writes are done in mutual exclusion.
-	 * Spin lock: must search for free list for one socket at a time, or
-	 * multiple sockets could take the same list.
+	 * time, but writes are done in mutual exclusion. The list_owner is
+	 * protected by the meta-socket lock, held by our caller.
 	 */
 	read_lock(&mptcp_gws_lock);
-	spin_lock(fmp->flow_lock);
 
-	i = mptcp_get_avail_list_ipv4(sk);
+	i = mptcp_get_avail_list(fmp, mptcp_gws);
 
 	/* Execution enters here only if a free path is found.
 	 */
 	if (i >= 0) {
 		opt[0] = IPOPT_NOP;
 		opt[1] = IPOPT_LSRR;
-		opt[2] = sizeof(mptcp_gws->list[i][0].s_addr) *
+		opt[2] = sizeof(mptcp_gws->list[i][0].ip) *
 				(mptcp_gws->len[i] + 1) + 3;
 		opt[3] = IPOPT_MINOFF;
 		for (j = 0; j < mptcp_gws->len[i]; ++j)
 			memcpy(opt + 4 +
-				(j * sizeof(mptcp_gws->list[i][0].s_addr)),
-				&mptcp_gws->list[i][j].s_addr,
-				sizeof(mptcp_gws->list[i][0].s_addr));
+				(j * sizeof(mptcp_gws->list[i][0].ip)),
+				&mptcp_gws->list[i][j].ip,
+				sizeof(mptcp_gws->list[i][0].ip));
 		/* Final destination must be part of IP_OPTIONS parameter. */
 		memcpy(opt + 4 + (j * sizeof(addr.s_addr)), &addr.s_addr,
 		       sizeof(addr.s_addr));
 
-		/* setsockopt must be inside the lock, otherwise another
-		 * subflow could fail to see that we have taken a list.
-		 */
 		ret = ip_setsockopt(sk, IPPROTO_IP, IP_OPTIONS, (char __user *)opt,
-				    4 + sizeof(mptcp_gws->list[i][0].s_addr) * (mptcp_gws->len[i] + 1));
+				    4 + sizeof(mptcp_gws->list[i][0].ip) * (mptcp_gws->len[i] + 1));
 
 		if (ret < 0) {
 			mptcp_debug("%s: MPTCP subsock setsockopt() IP_OPTIONS failed, error %d\n",
 				    __func__, ret);
+		} else {
+			fmp->list_owner[i] = tp->mptcp->path_index;
 		}
 	}
 
-	spin_unlock(fmp->flow_lock);
 	read_unlock(&mptcp_gws_lock);
 
 	return;
 }
 
+#if IS_ENABLED(CONFIG_IPV6)
+/* Same as mptcp_v4_add_lsrr, but steering the subflow along a list of
+ * segments with a Segment Routing Header.
+ */
+static void mptcp_v6_add_srh(struct sock *sk, struct in6_addr addr)
+{
+	u8 buf[sizeof(struct ipv6_sr_hdr) +
+	       (MPTCP_GW_LIST_MAX_LEN + 1) * sizeof(struct in6_addr)] __aligned(8);
+	struct ipv6_sr_hdr *srh = (struct ipv6_sr_hdr *)buf;
+	struct tcp_sock *tp = tcp_sk(sk);
+	struct binder_priv *fmp = (struct binder_priv *)&tp->mpcb->mptcp_pm[0];
+	int i, j, len, ret;
+
+	read_lock(&mptcp_gws_lock);
+
+	i = mptcp_get_avail_list(fmp, mptcp_segs);
+	if (i < 0)
+		goto exit;
+
+	len = mptcp_segs->len[i];
+	memset(buf, 0, sizeof(buf));
+	srh->hdrlen = (len + 1) * sizeof(struct in6_addr) >> 3;
+	srh->type = IPV6_SRCRT_TYPE_4;
+	srh->segments_left = len;
+	srh->first_segment = len;
+
+	/* The segments are in reverse order, the final destination (our peer)
+	 * being the first one. It gets overwritten upon transmission with the
+	 * destination of the socket anyways.
+	 */
+	srh->segments[0] = addr;
+	for (j = 0; j < len; j++)
+		srh->segments[len - j] = mptcp_segs->list[i][j].in6;
+
+	ret = mptcp_v6_set_srh(sk, srh);
+	if (ret < 0)
+		mptcp_debug("%s: MPTCP subsock setting the SRH failed, error %d\n",
+			    __func__, ret);
+	else
+		fmp->list_owner[i] = tp->mptcp->path_index;
+
+exit:
+	read_unlock(&mptcp_gws_lock);
+}
+#endif
+
+/* The subflow is gone - its list becomes available again */
+static void binder_delete_subflow(struct sock *sk)
+{
+	const struct tcp_sock *tp = tcp_sk(sk);
+	struct binder_priv *fmp = (struct binder_priv *)&tp->mpcb->mptcp_pm[0];
+	int i;
+
+	for (i = 0; i < MPTCP_GW_MAX_LISTS; i++) {
+		if (fmp->list_owner[i] == tp->mptcp->path_index)
+			fmp->list_owner[i] = 0;
+	}
+}
+
 /* Parses gateways string for a list of paths to different
  * gateways, and stores them for use with the Loose Source Routing (LSRR)
- * socket option. Each list must have "," separated addresses, and the lists
- * themselves must be separated by "-". Returns -1 in case one or more of the
- * addresses is not a valid ipv4/6 address.
+ * socket option, or with the Segment Routing Header for IPv6. Each list must
+ * have "," separated addresses, and the lists themselves must be separated
+ * by "-". Returns -1 in case one or more of the addresses is not a valid
+ * ipv4/6 address.
  */
-static int mptcp_parse_gateway_ipv4(char *gateways)
+static int mptcp_parse_gateways(char *gateways, int maxlen, sa_family_t family,
+				struct mptcp_gw_list *gws)
 {
 	int i, j, k, ret;
 	char *tmp_string = NULL;
-	struct in_addr tmp_addr;
+	union inet_addr tmp_addr;
 
-	tmp_string = kzalloc(16, GFP_KERNEL);
+	tmp_string = kzalloc(INET6_ADDRSTRLEN, GFP_KERNEL);
 	if (tmp_string == NULL)
 		return -ENOMEM;
 
 	write_lock(&mptcp_gws_lock);
 
-	memset(mptcp_gws, 0, sizeof(struct mptcp_gw_list));
+	memset(gws, 0, sizeof(struct mptcp_gw_list));
+	mptcp_gws_gen++;
 
 	/* A TMP string is used since inet_pton needs a null terminated string
 	 * but we do not want to modify the sysctl for obvious reasons.
@@ -220,14 +219,12 @@ static int mptcp_parse_gateway_ipv4(char *gateways)
 	 * temporary string where each IP is copied into, k will iterate over
 	 * the IPs in each list.
 	 */
-	for (i = j = k = 0;
-			i < MPTCP_GW_SYSCTL_MAX_LEN && k < MPTCP_GW_MAX_LISTS;
-			++i) {
+	for (i = j = k = 0; i < maxlen && k < MPTCP_GW_MAX_LISTS; ++i) {
 		if (gateways[i] == '-' || gateways[i] == ',' || gateways[i] == '\0') {
 			/* If the temp IP is empty and the current list is
 			 *  empty, we are done.
 			 */
-			if (j == 0 && mptcp_gws->len[k] == 0)
+			if (j == 0 && gws->len[k] == 0)
 				break;
 
 			/* Terminate the temp IP string, then if it is
@@ -237,31 +234,33 @@ static int mptcp_parse_gateway_ipv4(char *gateways)
 			if (j > 0) {
 				mptcp_debug("mptcp_parse_gateway_list tmp: %s i: %d\n", tmp_string, i);
 
-				ret = in4_pton(tmp_string, strlen(tmp_string),
-						(u8 *)&tmp_addr.s_addr, '\0',
-						NULL);
+				if (family == AF_INET)
+					ret = in4_pton(tmp_string, strlen(tmp_string),
+						       (u8 *)&tmp_addr.ip, '\0',
+						       NULL);
+				else
+					ret = in6_pton(tmp_string, strlen(tmp_string),
+						       (u8 *)&tmp_addr.in6, '\0',
+						       NULL);
 
 				if (ret) {
-					mptcp_debug("mptcp_parse_gateway_list ret: %d s_addr: %pI4\n",
-						    ret,
-						    &tmp_addr.s_addr);
-					memcpy(&mptcp_gws->list[k][mptcp_gws->len[k]].s_addr,
-					       &tmp_addr.s_addr,
-					       sizeof(tmp_addr.s_addr));
-					mptcp_gws->len[k]++;
-					j = 0;
-					tmp_string[j] = '\0';
+					mptcp_debug("mptcp_parse_gateway_list ret: %d\n",
+						    ret);
 					/* Since we can't impose a limit to
 					 * what the user can input, make sure
 					 * there are not too many IPs in the
 					 * SYSCTL string.
 					 */
-					if (mptcp_gws->len[k] > MPTCP_GW_LIST_MAX_LEN) {
+					if (gws->len[k] >= MPTCP_GW_LIST_MAX_LEN) {
 						mptcp_debug("mptcp_parse_gateway_list too many members in list %i: max %i\n",
 							    k,
 							    MPTCP_GW_LIST_MAX_LEN);
 						goto error;
 					}
+					gws->list[k][gws->len[k]] = tmp_addr;
+					gws->len[k]++;
+					j = 0;
+					tmp_string[j] = '\0';
 				} else {
 					goto error;
 				}
@@ -269,14 +268,15 @@ static int mptcp_parse_gateway_ipv4(char *gateways)
 
 			if (gateways[i] == '-' || gateways[i] == '\0')
 				++k;
-		} else {
+		} else if (j < INET6_ADDRSTRLEN - 1) {
 			tmp_string[j] = gateways[i];
 			++j;
+		} else {
+			goto error;
 		}
 	}
 
-	/* Number of flows is number of gateway lists plus master flow */
-	mptcp_binder_ndiffports = k+1;
+	gws->count = k;
 
 	write_unlock(&mptcp_gws_lock);
 	kfree(tmp_string);
@@ -284,8 +284,8 @@ static int mptcp_parse_gateway_ipv4(char *gateways)
 	return 0;
 
 error:
-	memset(mptcp_gws, 0, sizeof(struct mptcp_gw_list));
-	memset(gateways, 0, sizeof(char) * MPTCP_GW_SYSCTL_MAX_LEN);
+	memset(gws, 0, sizeof(struct mptcp_gw_list));
+	memset(gateways, 0, sizeof(char) * maxlen);
 	write_unlock(&mptcp_gws_lock);
 	kfree(tmp_string);
 	return -1;
@@ -305,7 +305,7 @@ static void create_subflow_worker(struct work_struct *work)
 						     subflow_work);
 	struct mptcp_cb *mpcb = pm_priv->mpcb;
 	struct sock *meta_sk = mpcb->meta_sk;
-	int iter = 0;
+	int iter = 0, num_subflows;
 
 next_subflow:
 	if (iter) {
@@ -329,20 +329,45 @@ static void create_subflow_worker(struct work_struct *work)
 	    !tcp_sk(mpcb->master_sk)->mptcp->fully_established)
 		goto exit;
 
-	if (mptcp_binder_ndiffports > iter &&
-	    mptcp_binder_ndiffports > mptcp_subflow_count(mpcb)) {
-		struct mptcp_loc4 loc;
-		struct mptcp_rem4 rem;
+	/* Number of flows is number of gateway lists plus master flow */
+	if (meta_sk->sk_family == AF_INET || mptcp_v6_is_v4_mapped(meta_sk))
+		num_subflows = READ_ONCE(mptcp_gws->count) + 1;
+	else
+		num_subflows = READ_ONCE(mptcp_segs->count) + 1;
+
+	if (num_subflows > iter && num_subflows > mptcp_subflow_count(mpcb)) {
+		if (meta_sk->sk_family == AF_INET ||
+		    mptcp_v6_is_v4_mapped(meta_sk)) {
+			struct mptcp_loc4 loc;
+			struct mptcp_rem4 rem;
+
+			loc.addr.s_addr = inet_sk(meta_sk)->inet_saddr;
+			loc.loc4_id = 0;
+			loc.low_prio = 0;
+			loc.if_idx = 0;
+
+			rem.addr.s_addr = inet_sk(meta_sk)->inet_daddr;
+			rem.port = inet_sk(meta_sk)->inet_dport;
+			rem.rem4_id = 0; /* Default 0 */
+
+			mptcp_init4_subsockets(meta_sk, &loc, &rem);
+		} else {
+#if IS_ENABLED(CONFIG_IPV6)
+			struct mptcp_loc6 loc;
+			struct mptcp_rem6 rem;
 
-		loc.addr.s_addr = inet_sk(meta_sk)->inet_saddr;
-		loc.loc4_id = 0;
-		loc.low_prio = 0;
+			loc.addr = inet6_sk(meta_sk)->saddr;
+			loc.loc6_id = 0;
+			loc.low_prio = 0;
+			loc.if_idx = 0;
 
-		rem.addr.s_addr = inet_sk(meta_sk)->inet_daddr;
-		rem.port = inet_sk(meta_sk)->inet_dport;
-		rem.rem4_id = 0; /* Default 0 */
+			rem.addr = meta_sk->sk_v6_daddr;
+			rem.port = inet_sk(meta_sk)->inet_dport;
+			rem.rem6_id = 0; /* Default 0 */
 
-		mptcp_init4_subsockets(meta_sk, &loc, &rem);
+			mptcp_init6_subsockets(meta_sk, &loc, &rem);
+#endif
+		}
 
 		goto next_subflow;
 	}
@@ -358,11 +383,11 @@ static void binder_new_session(const struct sock *meta_sk)
 {
 	struct mptcp_cb *mpcb = tcp_sk(meta_sk)->mpcb;
 	struct binder_priv *fmp = (struct binder_priv *)&mpcb->mptcp_pm[0];
-	static DEFINE_SPINLOCK(flow_lock);
 
 #if IS_ENABLED(CONFIG_IPV6)
+	/* Native IPv6 is only steered if there are segment-lists */
 	if (meta_sk->sk_family == AF_INET6 &&
-	    !mptcp_v6_is_v4_mapped(meta_sk)) {
+	    !mptcp_v6_is_v4_mapped(meta_sk) && !READ_ONCE(mptcp_segs->count)) {
 			mptcp_fallback_default(mpcb);
 			return;
 	}
@@ -372,7 +397,8 @@ static void binder_new_session(const struct sock *meta_sk)
 	INIT_WORK(&fmp->subflow_work, create_subflow_worker);
 	fmp->mpcb = mpcb;
 
-	fmp->flow_lock = &flow_lock;
+	memset(fmp->list_owner, 0, sizeof(fmp->list_owner));
+	fmp->list_gen = mptcp_gws_gen;
 }
 
 static void binder_create_subflows(struct sock *meta_sk)
@@ -387,7 +413,8 @@ static void binder_create_subflows(struct sock *meta_sk)
 	if (!work_pending(&pm_priv->subflow_work)) {
 		sock_hold(meta_sk);
 		refcount_inc(&mpcb->mpcb_refcnt);
-		queue_work(mptcp_wq, &pm_priv->subflow_work);
+		queue_work_on(mptcp_work_cpu(mpcb, NULL), mptcp_conn_wq,
+			      &pm_priv->subflow_work);
 	}
 }
 
@@ -406,17 +433,22 @@ static int proc_mptcp_gateways(struct ctl_table *ctl, int write,
 {
 	int ret;
 	struct ctl_table tbl = {
-		.maxlen = MPTCP_GW_SYSCTL_MAX_LEN,
+		.maxlen = ctl->maxlen,
 	};
 
 	if (write) {
-		tbl.data = kzalloc(MPTCP_GW_SYSCTL_MAX_LEN, GFP_KERNEL);
+		tbl.data = kzalloc(ctl->maxlen, GFP_KERNEL);
 		if (tbl.data == NULL)
 			return -ENOMEM;
 		ret = proc_dostring(&tbl, write, buffer, lenp, ppos);
 		if (ret == 0) {
-			ret = mptcp_parse_gateway_ipv4(tbl.data);
-			memcpy(ctl->data, tbl.data, MPTCP_GW_SYSCTL_MAX_LEN);
+			if (ctl->data == sysctl_mptcp_binder_segments)
+				ret = mptcp_parse_gateways(tbl.data, ctl->maxlen,
+							   AF_INET6, mptcp_segs);
+			else
+				ret = mptcp_parse_gateways(tbl.data, ctl->maxlen,
+							   AF_INET, mptcp_gws);
+			memcpy(ctl->data, tbl.data, ctl->maxlen);
 		}
 		kfree(tbl.data);
 	} else {
@@ -432,6 +464,10 @@ static struct mptcp_pm_ops binder __read_mostly = {
 	.fully_established = binder_create_subflows,
 	.get_local_id = binder_get_local_id,
 	.init_subsocket_v4 = mptcp_v4_add_lsrr,
+#if IS_ENABLED(CONFIG_IPV6)
+	.init_subsocket_v6 = mptcp_v6_add_srh,
+#endif
+	.delete_subflow = binder_delete_subflow,
 	.name = "binder",
 	.owner = THIS_MODULE,
 };
@@ -444,6 +480,13 @@ static struct ctl_table binder_table[] = {
 		.mode = 0644,
 		.proc_handler = &proc_mptcp_gateways
 	},
+	{
+		.procname = "mptcp_binder_segments",
+		.data = &sysctl_mptcp_binder_segments,
+		.maxlen = sizeof(char) * MPTCP_SEG_SYSCTL_MAX_LEN,
+		.mode = 0644,
+		.proc_handler = &proc_mptcp_gateways
+	},
 	{ }
 };
 
@@ -456,6 +499,12 @@ static int __init binder_register(void)
 	if (!mptcp_gws)
 		return -ENOMEM;
 
+	mptcp_segs = kzalloc(sizeof(*mptcp_segs), GFP_KERNEL);
+	if (!mptcp_segs) {
+		kfree(mptcp_gws);
+		return -ENOMEM;
+	}
+
 	rwlock_init(&mptcp_gws_lock);
 
 	BUILD_BUG_ON(sizeof(struct binder_priv) > MPTCP_PM_SIZE);
@@ -473,6 +522,7 @@ static int __init binder_register(void)
 pm_failed:
 	unregister_net_sysctl_table(mptcp_sysctl_binder);
 sysctl_fail:
+	kfree(mptcp_segs);
 	kfree(mptcp_gws);
 
 	return -1;
@@ -482,6 +532,7 @@ static void binder_unregister(void)
 {
 	mptcp_unregister_path_manager(&binder);
 	unregister_net_sysctl_table(mptcp_sysctl_binder);
+	kfree(mptcp_segs);
 	kfree(mptcp_gws);
 }
 
@@ -180,7 +180,7 @@ struct sock *blest_get_available_subflow(struct sock *meta_sk, struct sk_buff *s
 		/* We do not send data on this subflow unless it is
 		 * fully established, i.e. the 4th ack has been received.
 		 */
-		if (besttp->mptcp->pre_established)
+		if (mptcp_sub_wait_fourth_ack(besttp))
 			continue;
 
 		blest_p->min_srtt_us = min(blest_p->min_srtt_us, besttp->srtt_us);
@@ -0,0 +1,282 @@
+// SPDX-License-Identifier: GPL-2.0
+/*	MPTCP Cost-aware Scheduler
+ *
+ *	Every subflow carries a cost (0 being the cheapest), set by the
+ *	path-manager (e.g., over the netlink path-manager). This scheduler
+ *	only sends on the cheapest subflows, as long as the measured goodput
+ *	of the connection reaches the target-rate. If it does not, the more
+ *	expensive subflows are added one cost-level after the other. Once the
+ *	goodput is above the target again, the expensive subflows are removed.
+ *
+ *	The target-rate can be set per connection through the
+ *	MPTCP_TARGET_RATE socket-option, or globally with the module
+ *	parameter. A target-rate of 0 means that only the cheapest subflows
+ *	are used.
+ *
+ *	This program is free software; you can redistribute it and/or
+ *	modify it under the terms of the GNU General Public License
+ *	as published by the Free Software Foundation; either version
+ *	2 of the License, or (at your option) any later version.
+ */
+
+#include <linux/module.h>
+#include <net/mptcp.h>
+
+static unsigned int target_rate __read_mostly;
+module_param(target_rate, uint, 0644);
+MODULE_PARM_DESC(target_rate, "Default target goodput in bytes per second (0 = cheapest subflows only)");
+
+static unsigned char hysteresis __read_mostly = 10;
+module_param(hysteresis, byte, 0644);
+MODULE_PARM_DESC(hysteresis, "Percentage around the target-rate within which the cost-level is not changed");
+
+static unsigned char hold_samples __read_mostly = 4;
+module_param(hold_samples, byte, 0644);
+MODULE_PARM_DESC(hold_samples, "Number of rate-samples to wait after a change of the cost-level");
+
+/* Rate-samples are taken at most once per RTT, but not more often than this */
+#define MPTCP_COST_MIN_INTERVAL_MS	10
+
+struct costsched_cb {
+	u32	last_una;	/* meta snd_una at the last rate-sample */
+	u32	last_tstamp;	/* jiffies of the last rate-sample */
+	u32	rate;		/* smoothed goodput in bytes per second */
+	u8	level;		/* highest cost we currently send on */
+	u8	hold;		/* rate-samples to wait before changing level */
+};
+
+static struct costsched_cb *costsched_get_cb(const struct tcp_sock *tp)
+{
+	return (struct costsched_cb *)&tp->mpcb->mptcp_sched[0];
+}
+
+static u32 costsched_target(const struct sock *meta_sk)
+{
+	return tcp_sk(meta_sk)->mptcp_target_rate ? : target_rate;
+}
+
+/* Is the meta limited by the network rather than by the application? */
+static bool costsched_backlogged(const struct sock *meta_sk)
+{
+	return tcp_send_head(meta_sk) ||
+	       !skb_queue_empty(&tcp_sk(meta_sk)->mpcb->reinject_queue);
+}
+
+/* Returns the cost-level next to the current one among the usable subflows,
+ * or the current one if there is none.
+ */
+static u8 costsched_next_level(struct mptcp_cb *mpcb, u8 level, bool up)
+{
+	struct mptcp_tcp_sock *mptcp;
+	int next = up ? U8_MAX + 1 : -1;
+
+	mptcp_for_each_sub(mpcb, mptcp) {
+		struct sock *sk = mptcp_to_sock(mptcp);
+		u8 cost = mptcp->cost;
+
+		if (mptcp_is_def_unavailable(sk))
+			continue;
+
+		if (up && cost > level && cost < next)
+			next = cost;
+		else if (!up && cost < level && cost > next)
+			next = cost;
+	}
+
+	if (next < 0 || next > U8_MAX)
+		return level;
+
+	return next;
+}
+
+static void costsched_update_level(struct sock *meta_sk, u32 srtt_us)
+{
+	const struct tcp_sock *meta_tp = tcp_sk(meta_sk);
+	struct costsched_cb *cost_cb = costsched_get_cb(meta_tp);
+	u32 now = tcp_jiffies32, interval, delta, target;
+	u64 sample;
+
+	interval = max_t(u32, usecs_to_jiffies(srtt_us >> 3),
+			 msecs_to_jiffies(MPTCP_COST_MIN_INTERVAL_MS));
+	delta = now - cost_cb->last_tstamp;
+	if (delta < interval)
+		return;
+
+	sample = div_u64((u64)(meta_tp->snd_una - cost_cb->last_una) * HZ,
+			 delta);
+	sample = min_t(u64, sample, U32_MAX);
+
+	/* EWMA with a gain of 1/4, like the BLEST lambda-update */
+	if (cost_cb->rate)
+		cost_cb->rate = cost_cb->rate - (cost_cb->rate >> 2) +
+				((u32)sample >> 2);
+	else
+		cost_cb->rate = sample;
+
+	cost_cb->last_una = meta_tp->snd_una;
+	cost_cb->last_tstamp = now;
+
+	if (cost_cb->hold) {
+		cost_cb->hold--;
+		return;
+	}
+
+	target = costsched_target(meta_sk);
+	if (!target) {
+		cost_cb->level = 0;
+		return;
+	}
+
+	if ((u64)cost_cb->rate * 100 < (u64)target * (100 - hysteresis)) {
+		/* Only spill if it is the network that is too slow */
+		if (!costsched_backlogged(meta_sk))
+			return;
+
+		cost_cb->level = costsched_next_level(meta_tp->mpcb,
+						      cost_cb->level, true);
+		cost_cb->hold = hold_samples;
+	} else if ((u64)cost_cb->rate * 100 >
+		   (u64)target * (100 + hysteresis)) {
+		cost_cb->level = costsched_next_level(meta_tp->mpcb,
+						      cost_cb->level, false);
+		cost_cb->hold = hold_samples;
+	}
+}
+
+/* Are we not allowed to reinject this skb on tp? */
+static bool costsched_dont_reinject_skb(const struct tcp_sock *tp,
+					const struct sk_buff *skb)
+{
+	return skb &&
+	       mptcp_pi_to_flag(tp->mptcp->path_index) & TCP_SKB_CB(skb)->path_mask;
+}
+
+/* We pick the cheapest available subflow within the allowed cost-level and
+ * among those the one with the lowest RTT. Backup subflows are only used if
+ * none of the active ones can be used at all.
+ */
+static struct sock *costsched_get_available_subflow(struct sock *meta_sk,
+						    struct sk_buff *skb,
+						    bool zero_wnd_test)
+{
+	struct mptcp_cb *mpcb = tcp_sk(meta_sk)->mpcb;
+	struct costsched_cb *cost_cb = costsched_get_cb(tcp_sk(meta_sk));
+	struct sock *bestsk = NULL;
+	bool has_active = false, best_unused = false;
+	u32 min_srtt = U32_MAX, best_srtt = U32_MAX;
+	struct mptcp_tcp_sock *mptcp;
+	u8 min_cost = U8_MAX, level, best_cost = U8_MAX;
+
+	/* Answer data_fin on same subflow!!! */
+	if (meta_sk->sk_shutdown & RCV_SHUTDOWN &&
+	    skb && mptcp_is_data_fin(skb)) {
+		mptcp_for_each_sub(mpcb, mptcp) {
+			bestsk = mptcp_to_sock(mptcp);
+
+			if (tcp_sk(bestsk)->mptcp->path_index == mpcb->dfin_path_index &&
+			    mptcp_is_available(bestsk, skb, zero_wnd_test))
+				return bestsk;
+		}
+		bestsk = NULL;
+	}
+
+	mptcp_for_each_sub(mpcb, mptcp) {
+		struct sock *sk = mptcp_to_sock(mptcp);
+		struct tcp_sock *tp = tcp_sk(sk);
+
+		if (mptcp_is_def_unavailable(sk))
+			continue;
+
+		if (subflow_is_active(tp))
+			has_active = true;
+
+		if (mptcp->cost < min_cost)
+			min_cost = mptcp->cost;
+
+		if (tp->srtt_us && tp->srtt_us < min_srtt)
+			min_srtt = tp->srtt_us;
+	}
+
+	if (min_srtt != U32_MAX)
+		costsched_update_level(meta_sk, min_srtt);
+
+	/* If the cheap subflows are gone, we have to use the next best */
+	level = max(cost_cb->level, min_cost);
+
+	mptcp_for_each_sub(mpcb, mptcp) {
+		struct sock *sk = mptcp_to_sock(mptcp);
+		struct tcp_sock *tp = tcp_sk(sk);
+		/* Without an RTT sample yet, the subflow ranks last */
+		u32 srtt = tp->srtt_us ? : U32_MAX;
+		bool unused;
+
+		if (mptcp->cost > level)
+			continue;
+
+		if (has_active && subflow_is_backup(tp))
+			continue;
+
+		if (!mptcp_is_available(sk, skb, zero_wnd_test))
+			continue;
+
+		/* Prefer subflows on which the skb has not yet been sent */
+		unused = !costsched_dont_reinject_skb(tp, skb);
+		if (best_unused && !unused)
+			continue;
+
+		if (bestsk && unused == best_unused &&
+		    (mptcp->cost > best_cost ||
+		     (mptcp->cost == best_cost && srtt >= best_srtt)))
+			continue;
+
+		bestsk = sk;
+		best_unused = unused;
+		best_cost = mptcp->cost;
+		best_srtt = srtt;
+	}
+
+	return bestsk;
+}
+
+static void costsched_init(struct sock *sk)
+{
+	struct sock *meta_sk = mptcp_meta_sk(sk);
+	struct costsched_cb *cost_cb = costsched_get_cb(tcp_sk(meta_sk));
+
+	/* Called for every new subflow, but the cb is per connection */
+	if (cost_cb->last_tstamp)
+		return;
+
+	cost_cb->last_tstamp = tcp_jiffies32;
+	cost_cb->last_una = tcp_sk(meta_sk)->snd_una;
+}
+
+static struct mptcp_sched_ops mptcp_sched_cost = {
+	.get_subflow = costsched_get_available_subflow,
+	.next_segment = mptcp_next_segment,
+	.init = costsched_init,
+	.name = "cost",
+	.owner = THIS_MODULE,
+};
+
+static int __init cost_register(void)
+{
+	BUILD_BUG_ON(sizeof(struct costsched_cb) > MPTCP_SCHED_DATA_SIZE);
+
+	if (mptcp_register_scheduler(&mptcp_sched_cost))
+		return -1;
+
+	return 0;
+}
+
+static void cost_unregister(void)
+{
+	mptcp_unregister_scheduler(&mptcp_sched_cost);
+}
+
+module_init(cost_register);
+module_exit(cost_unregister);
+
+MODULE_LICENSE("GPL");
+MODULE_DESCRIPTION("Cost-aware scheduler for MPTCP, spilling over to expensive subflows to reach a target-rate");
+MODULE_VERSION("0.95");
@@ -42,9 +42,12 @@ static int alpha_scale_den = 10;
 static int alpha_scale_num = 32;
 static int alpha_scale = 12;
 
+/* Every subflow keeps its own alpha and recomputes it once it sees a new
+ * mpcb->cc_gen, so that it only ever writes its own CA-state.
+ */
 struct mptcp_ccc {
 	u64	alpha;
-	bool	forced_update;
+	u32	cc_gen;
 };
 
 static inline int mptcp_ccc_sk_can_send(const struct sock *sk)
@@ -52,14 +55,14 @@ static inline int mptcp_ccc_sk_can_send(const struct sock *sk)
 	return mptcp_sk_can_send(sk) && tcp_sk(sk)->srtt_us;
 }
 
-static inline u64 mptcp_get_alpha(const struct sock *meta_sk)
+static inline u64 mptcp_get_alpha(const struct sock *sk)
 {
-	return ((struct mptcp_ccc *)inet_csk_ca(meta_sk))->alpha;
+	return ((struct mptcp_ccc *)inet_csk_ca(sk))->alpha;
 }
 
-static inline void mptcp_set_alpha(const struct sock *meta_sk, u64 alpha)
+static inline void mptcp_set_alpha(const struct sock *sk, u64 alpha)
 {
-	((struct mptcp_ccc *)inet_csk_ca(meta_sk))->alpha = alpha;
+	((struct mptcp_ccc *)inet_csk_ca(sk))->alpha = alpha;
 }
 
 static inline u64 mptcp_ccc_scale(u32 val, int scale)
@@ -67,14 +70,14 @@ static inline u64 mptcp_ccc_scale(u32 val, int scale)
 	return (u64) val << scale;
 }
 
-static inline bool mptcp_get_forced(const struct sock *meta_sk)
+static inline u32 mptcp_get_cc_gen(const struct sock *sk)
 {
-	return ((struct mptcp_ccc *)inet_csk_ca(meta_sk))->forced_update;
+	return ((struct mptcp_ccc *)inet_csk_ca(sk))->cc_gen;
 }
 
-static inline void mptcp_set_forced(const struct sock *meta_sk, bool force)
+static inline void mptcp_set_cc_gen(const struct sock *sk, u32 gen)
 {
-	((struct mptcp_ccc *)inet_csk_ca(meta_sk))->forced_update = force;
+	((struct mptcp_ccc *)inet_csk_ca(sk))->cc_gen = gen;
 }
 
 static void mptcp_ccc_recalc_alpha(const struct sock *sk)
@@ -95,7 +98,8 @@ static void mptcp_ccc_recalc_alpha(const struct sock *sk)
 		struct tcp_sock *sub_tp = tcp_sk(sub_sk);
 		u64 tmp;
 
-		if (!mptcp_ccc_sk_can_send(sub_sk))
+		if (!mptcp_ccc_sk_can_send(sub_sk) ||
+		    !mptcp_sbd_coupled(sk, sub_sk))
 			continue;
 
 		can_send++;
@@ -123,7 +127,8 @@ static void mptcp_ccc_recalc_alpha(const struct sock *sk)
 		const struct sock *sub_sk = mptcp_to_sock(mptcp);
 		struct tcp_sock *sub_tp = tcp_sk(sub_sk);
 
-		if (!mptcp_ccc_sk_can_send(sub_sk))
+		if (!mptcp_ccc_sk_can_send(sub_sk) ||
+		    !mptcp_sbd_coupled(sk, sub_sk))
 			continue;
 
 		sum_denominator += div_u64(
@@ -150,14 +155,14 @@ static void mptcp_ccc_recalc_alpha(const struct sock *sk)
 		alpha = 1;
 
 exit:
-	mptcp_set_alpha(mptcp_meta_sk(sk), alpha);
+	mptcp_set_alpha(sk, alpha);
 }
 
 static void mptcp_ccc_init(struct sock *sk)
 {
 	if (mptcp(tcp_sk(sk))) {
-		mptcp_set_forced(mptcp_meta_sk(sk), 0);
-		mptcp_set_alpha(mptcp_meta_sk(sk), 1);
+		mptcp_set_cc_gen(sk, tcp_sk(sk)->mpcb->cc_gen);
+		mptcp_set_alpha(sk, 1);
 	}
 	/* If we do not mptcp, behave like reno: return */
 }
@@ -173,7 +178,7 @@ static void mptcp_ccc_set_state(struct sock *sk, u8 ca_state)
 	if (!mptcp(tcp_sk(sk)))
 		return;
 
-	mptcp_set_forced(mptcp_meta_sk(sk), 1);
+	tcp_sk(sk)->mpcb->cc_gen++;
 }
 
 static void mptcp_ccc_cong_avoid(struct sock *sk, u32 ack, u32 acked)
@@ -197,12 +202,12 @@ static void mptcp_ccc_cong_avoid(struct sock *sk, u32 ack, u32 acked)
 		return;
 	}
 
-	if (mptcp_get_forced(mptcp_meta_sk(sk))) {
+	if (mptcp_get_cc_gen(sk) != tp->mpcb->cc_gen) {
 		mptcp_ccc_recalc_alpha(sk);
-		mptcp_set_forced(mptcp_meta_sk(sk), 0);
+		mptcp_set_cc_gen(sk, tp->mpcb->cc_gen);
 	}
 
-	alpha = mptcp_get_alpha(mptcp_meta_sk(sk));
+	alpha = mptcp_get_alpha(sk);
 
 	/* This may happen, if at the initialization, the mpcb
 	 * was not yet attached to the sock, and thus
@@ -237,6 +242,7 @@ static struct tcp_congestion_ops mptcp_ccc = {
 	.cong_avoid	= mptcp_ccc_cong_avoid,
 	.undo_cwnd	= tcp_reno_undo_cwnd,
 	.cwnd_event	= mptcp_ccc_cwnd_event,
+	.pkts_acked	= mptcp_sbd_pkts_acked,
 	.set_state	= mptcp_ccc_set_state,
 	.owner		= THIS_MODULE,
 	.name		= "lia",
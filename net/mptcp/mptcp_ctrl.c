@@ -61,6 +61,9 @@
 #include <linux/workqueue.h>
 #include <linux/atomic.h>
 #include <linux/sysctl.h>
+#include <linux/mptcp.h>
+#include <linux/skmsg.h>
+#include <linux/cgroup.h>
 
 static struct kmem_cache *mptcp_sock_cache __read_mostly;
 static struct kmem_cache *mptcp_cb_cache __read_mostly;
@@ -74,6 +77,22 @@ int sysctl_mptcp_checksum __read_mostly = 1;
 int sysctl_mptcp_debug __read_mostly;
 EXPORT_SYMBOL(sysctl_mptcp_debug);
 int sysctl_mptcp_syn_retries __read_mostly = 3;
+int sysctl_mptcp_ack_economy __read_mostly = 1;
+int sysctl_mptcp_idle_park __read_mostly;
+int sysctl_mptcp_unpark_latency __read_mostly = 200;
+int sysctl_mptcp_join_early_data __read_mostly;
+/* mptcp_lazy_token: reserve the token of a passive opener only once its
+ * meta-socket gets created, instead of for every MP_CAPABLE SYN. This only
+ * defers the locking - the meta-socket itself is still built eagerly when
+ * the handshake completes, whether or not an MP_JOIN ever arrives. If the
+ * token got taken in the meantime, the connection can't accept MP_JOINs.
+ */
+int sysctl_mptcp_lazy_token __read_mostly;
+int sysctl_mptcp_opti_budget __read_mostly = 10;
+int sysctl_mptcp_cpu_affinity __read_mostly = MPTCP_CPU_AFFINITY_APP;
+int sysctl_mptcp_server_id_bits __read_mostly;
+static int max_mptcp_server_id_bits = MPTCP_SERVER_ID_BITS_MAX;
+int sysctl_mptcp_server_id __read_mostly;
 
 bool mptcp_init_failed __read_mostly;
 
@@ -158,6 +177,85 @@ static struct ctl_table mptcp_table[] = {
 		.mode = 0644,
 		.proc_handler = &proc_dointvec
 	},
+	{
+		.procname = "mptcp_ack_economy",
+		.data = &sysctl_mptcp_ack_economy,
+		.maxlen = sizeof(int),
+		.mode = 0644,
+		.proc_handler = &proc_dointvec
+	},
+	{
+		.procname = "mptcp_idle_park",
+		.data = &sysctl_mptcp_idle_park,
+		.maxlen = sizeof(int),
+		.mode = 0644,
+		.proc_handler = &proc_dointvec_jiffies
+	},
+	{
+		.procname = "mptcp_unpark_latency",
+		.data = &sysctl_mptcp_unpark_latency,
+		.maxlen = sizeof(int),
+		.mode = 0644,
+		.proc_handler = &proc_dointvec
+	},
+	{
+		.procname = "mptcp_join_early_data",
+		.data = &sysctl_mptcp_join_early_data,
+		.maxlen = sizeof(int),
+		.mode = 0644,
+		.proc_handler = &proc_dointvec
+	},
+	{
+		.procname = "mptcp_lazy_token",
+		.data = &sysctl_mptcp_lazy_token,
+		.maxlen = sizeof(int),
+		.mode = 0644,
+		.proc_handler = &proc_dointvec
+	},
+	{
+		.procname = "mptcp_opti_budget",
+		.data = &sysctl_mptcp_opti_budget,
+		.maxlen = sizeof(int),
+		.mode = 0644,
+		.proc_handler = &proc_dointvec
+	},
+	{
+		.procname = "mptcp_cpu_affinity",
+		.data = &sysctl_mptcp_cpu_affinity,
+		.maxlen = sizeof(int),
+		.mode = 0644,
+		.proc_handler = &proc_dointvec
+	},
+	{
+		.procname = "mptcp_server_id_bits",
+		.data = &sysctl_mptcp_server_id_bits,
+		.maxlen = sizeof(int),
+		.mode = 0644,
+		.proc_handler = &proc_dointvec_minmax,
+		.extra1 = SYSCTL_ZERO,
+		.extra2 = &max_mptcp_server_id_bits,
+	},
+	{
+		.procname = "mptcp_server_id",
+		.data = &sysctl_mptcp_server_id,
+		.maxlen = sizeof(int),
+		.mode = 0644,
+		.proc_handler = &proc_dointvec
+	},
+	{
+		.procname = "mptcp_sbd",
+		.data = &sysctl_mptcp_sbd,
+		.maxlen = sizeof(int),
+		.mode = 0644,
+		.proc_handler = &proc_dointvec
+	},
+	{
+		.procname = "mptcp_path_metrics",
+		.data = &sysctl_mptcp_path_metrics,
+		.maxlen = sizeof(int),
+		.mode = 0644,
+		.proc_handler = &proc_dointvec
+	},
 	{
 		.procname	= "mptcp_path_manager",
 		.mode		= 0644,
@@ -173,9 +271,12 @@ static struct ctl_table mptcp_table[] = {
 	{ }
 };
 
+/* Mix the token first - with a server-id, the bits that are the same for
+ * all of our tokens would otherwise select the bucket.
+ */
 static inline u32 mptcp_hash_tk(u32 token, struct mptcp_hashtable *htable)
 {
-	return token & htable->mask;
+	return jhash_1word(token, 0) & htable->mask;
 }
 
 struct mptcp_hashtable mptcp_tk_htable;
@@ -223,6 +324,10 @@ static void mptcp_reqsk_insert_tk(struct request_sock *reqsk, const u32 token)
 
 static void mptcp_reqsk_remove_tk(const struct request_sock *reqsk)
 {
+	/* Only the request itself inserts it - no need to lock */
+	if (hlist_nulls_unhashed(&mptcp_rsk(reqsk)->hash_entry))
+		return;
+
 	rcu_read_lock();
 	local_bh_disable();
 	spin_lock(&mptcp_tk_hashlock);
@@ -271,6 +376,43 @@ static bool mptcp_find_token(u32 token)
 	return false;
 }
 
+/* Is the token taken by the connection that owns key? */
+static bool mptcp_find_token_key(u32 token, u64 key)
+{
+	const u32 hash = mptcp_hash_tk(token, &mptcp_tk_htable);
+	const struct tcp_sock *meta_tp;
+	const struct hlist_nulls_node *node;
+
+begin:
+	hlist_nulls_for_each_entry_rcu(meta_tp, node,
+				       &mptcp_tk_htable.hashtable[hash],
+				       tk_table) {
+		if (token == meta_tp->mptcp_loc_token &&
+		    key == meta_tp->mptcp_loc_key)
+			return true;
+	}
+	/* See mptcp_find_token */
+	if (get_nulls_value(node) != hash)
+		goto begin;
+	return false;
+}
+
+/* Does the token carry our server-id (see mptcp_token_server_id())? */
+static bool mptcp_token_server_id_ok(u32 token)
+{
+	int bits = READ_ONCE(sysctl_mptcp_server_id_bits);
+
+	if (!bits)
+		return true;
+
+	return mptcp_token_server_id((__force __be32)token, bits) ==
+	       (READ_ONCE(sysctl_mptcp_server_id) & ((1 << bits) - 1));
+}
+
+/* With a server-id, keys are derived from consecutive seeds until the token
+ * matches - 2^mptcp_server_id_bits hashes on average. This remains
+ * deterministic for a given seed, as needed by syn-cookies.
+ */
 static void mptcp_set_key_reqsk(struct request_sock *req,
 				const struct sk_buff *skb,
 				u32 seed)
@@ -278,23 +420,26 @@ static void mptcp_set_key_reqsk(struct request_sock *req,
 	const struct inet_request_sock *ireq = inet_rsk(req);
 	struct mptcp_request_sock *mtreq = mptcp_rsk(req);
 
-	if (skb->protocol == htons(ETH_P_IP)) {
-		mtreq->mptcp_loc_key = mptcp_v4_get_key(ip_hdr(skb)->saddr,
-							ip_hdr(skb)->daddr,
-							htons(ireq->ir_num),
-							ireq->ir_rmt_port,
-							seed);
+	do {
+		if (skb->protocol == htons(ETH_P_IP)) {
+			mtreq->mptcp_loc_key = mptcp_v4_get_key(ip_hdr(skb)->saddr,
+								ip_hdr(skb)->daddr,
+								htons(ireq->ir_num),
+								ireq->ir_rmt_port,
+								seed++);
 #if IS_ENABLED(CONFIG_IPV6)
-	} else {
-		mtreq->mptcp_loc_key = mptcp_v6_get_key(ipv6_hdr(skb)->saddr.s6_addr32,
-							ipv6_hdr(skb)->daddr.s6_addr32,
-							htons(ireq->ir_num),
-							ireq->ir_rmt_port,
-							seed);
+		} else {
+			mtreq->mptcp_loc_key = mptcp_v6_get_key(ipv6_hdr(skb)->saddr.s6_addr32,
+								ipv6_hdr(skb)->daddr.s6_addr32,
+								htons(ireq->ir_num),
+								ireq->ir_rmt_port,
+								seed++);
 #endif
-	}
+		}
 
-	mptcp_key_hash(mtreq->mptcp_ver, mtreq->mptcp_loc_key, &mtreq->mptcp_loc_token, NULL);
+		mptcp_key_hash(mtreq->mptcp_ver, mtreq->mptcp_loc_key,
+			       &mtreq->mptcp_loc_token, NULL);
+	} while (!mptcp_token_server_id_ok(mtreq->mptcp_loc_token));
 }
 
 /* New MPTCP-connection request, prepare a new token for the meta-socket that
@@ -318,13 +463,31 @@ static void mptcp_reqsk_new_mptcp(struct request_sock *req,
 
 	rcu_read_lock();
 	local_bh_disable();
-	spin_lock(&mptcp_tk_hashlock);
-	do {
-		mptcp_set_key_reqsk(req, skb, mptcp_seed++);
-	} while (mptcp_reqsk_find_tk(mtreq->mptcp_loc_token) ||
-		 mptcp_find_token(mtreq->mptcp_loc_token));
-	mptcp_reqsk_insert_tk(req, mtreq->mptcp_loc_token);
-	spin_unlock(&mptcp_tk_hashlock);
+	if (sysctl_mptcp_lazy_token) {
+		/* The token only gets reserved once the meta-socket is
+		 * created, so that requests which never complete the
+		 * handshake don't take the global lock. A collision with
+		 * another pending request is handled in mptcp_alloc_mpcb.
+		 */
+		do {
+			mptcp_set_key_reqsk(req, skb, mptcp_next_seed());
+		} while (mptcp_find_token(mtreq->mptcp_loc_token));
+	} else {
+		/* The key is derived outside of the lock, as this may take a
+		 * while with a server-id.
+		 */
+		for (;;) {
+			mptcp_set_key_reqsk(req, skb, mptcp_next_seed());
+
+			spin_lock(&mptcp_tk_hashlock);
+			if (!mptcp_reqsk_find_tk(mtreq->mptcp_loc_token) &&
+			    !mptcp_find_token(mtreq->mptcp_loc_token))
+				break;
+			spin_unlock(&mptcp_tk_hashlock);
+		}
+		mptcp_reqsk_insert_tk(req, mtreq->mptcp_loc_token);
+		spin_unlock(&mptcp_tk_hashlock);
+	}
 	local_bh_enable();
 	rcu_read_unlock();
 
@@ -349,10 +512,10 @@ static int mptcp_reqsk_new_cookie(struct request_sock *req,
 
 	rcu_read_lock();
 	local_bh_disable();
-	spin_lock(&mptcp_tk_hashlock);
 
 	mptcp_set_key_reqsk(req, skb, tcp_rsk(req)->snt_isn);
 
+	spin_lock(&mptcp_tk_hashlock);
 	if (mptcp_reqsk_find_tk(mtreq->mptcp_loc_token) ||
 	    mptcp_find_token(mtreq->mptcp_loc_token)) {
 		spin_unlock(&mptcp_tk_hashlock);
@@ -380,22 +543,25 @@ static void mptcp_set_key_sk(const struct sock *sk)
 	struct tcp_sock *tp = tcp_sk(sk);
 	const struct inet_sock *isk = inet_sk(sk);
 
-	if (sk->sk_family == AF_INET)
-		tp->mptcp_loc_key = mptcp_v4_get_key(isk->inet_saddr,
-						     isk->inet_daddr,
-						     isk->inet_sport,
-						     isk->inet_dport,
-						     mptcp_seed++);
+	do {
+		if (sk->sk_family == AF_INET)
+			tp->mptcp_loc_key = mptcp_v4_get_key(isk->inet_saddr,
+							     isk->inet_daddr,
+							     isk->inet_sport,
+							     isk->inet_dport,
+							     mptcp_next_seed());
 #if IS_ENABLED(CONFIG_IPV6)
-	else
-		tp->mptcp_loc_key = mptcp_v6_get_key(inet6_sk(sk)->saddr.s6_addr32,
-						     sk->sk_v6_daddr.s6_addr32,
-						     isk->inet_sport,
-						     isk->inet_dport,
-						     mptcp_seed++);
+		else
+			tp->mptcp_loc_key = mptcp_v6_get_key(inet6_sk(sk)->saddr.s6_addr32,
+							     sk->sk_v6_daddr.s6_addr32,
+							     isk->inet_sport,
+							     isk->inet_dport,
+							     mptcp_next_seed());
 #endif
 
-	mptcp_key_hash(tp->mptcp_ver, tp->mptcp_loc_key, &tp->mptcp_loc_token, NULL);
+		mptcp_key_hash(tp->mptcp_ver, tp->mptcp_loc_key,
+			       &tp->mptcp_loc_token, NULL);
+	} while (!mptcp_token_server_id_ok(tp->mptcp_loc_token));
 }
 
 #ifdef CONFIG_JUMP_LABEL
@@ -514,11 +680,15 @@ void mptcp_connect_init(struct sock *sk)
 
 	rcu_read_lock();
 	local_bh_disable();
-	spin_lock(&mptcp_tk_hashlock);
-	do {
+	for (;;) {
 		mptcp_set_key_sk(sk);
-	} while (mptcp_reqsk_find_tk(tp->mptcp_loc_token) ||
-		 mptcp_find_token(tp->mptcp_loc_token));
+
+		spin_lock(&mptcp_tk_hashlock);
+		if (!mptcp_reqsk_find_tk(tp->mptcp_loc_token) &&
+		    !mptcp_find_token(tp->mptcp_loc_token))
+			break;
+		spin_unlock(&mptcp_tk_hashlock);
+	}
 
 	__mptcp_hash_insert(tp, tp->mptcp_loc_token);
 	spin_unlock(&mptcp_tk_hashlock);
@@ -679,7 +849,9 @@ void mptcp_mpcb_put(struct mptcp_cb *mpcb)
 	if (refcount_dec_and_test(&mpcb->mpcb_refcnt)) {
 		mptcp_cleanup_path_manager(mpcb);
 		mptcp_cleanup_scheduler(mpcb);
+		mptcp_policy_put(mpcb->policy);
 		kfree(mpcb->master_info);
+		kfree(mpcb->parked);
 		kmem_cache_free(mptcp_cb_cache, mpcb);
 	}
 }
@@ -848,7 +1020,7 @@ static void mptcp_assign_congestion_control(struct sock *sk)
 }
 
 siphash_key_t mptcp_secret __read_mostly;
-u32 mptcp_seed = 0;
+atomic_t mptcp_seed = ATOMIC_INIT(0);
 
 #define SHA256_DIGEST_WORDS (SHA256_DIGEST_SIZE / 4)
 
@@ -1091,6 +1263,39 @@ static void mptcp_mpcb_inherit_sockopts(struct sock *meta_sk, struct sock *maste
 	inet_sk(master_sk)->recverr = 0;
 }
 
+/* Subflows that the path-manager creates from a kworker would otherwise be
+ * accounted to the root cgroups, and MP_JOIN children get no memcg until
+ * accept(). Put them in the cgroup and memcg of the meta-socket, before any
+ * cgroup-bpf program sees them.
+ */
+static void mptcp_sub_inherit_cgroups(const struct sock *meta_sk,
+				      struct sock *sk)
+{
+#ifdef CONFIG_SOCK_CGROUP_DATA
+	cgroup_sk_free(&sk->sk_cgrp_data);
+	sk->sk_cgrp_data = meta_sk->sk_cgrp_data;
+	cgroup_sk_clone(&sk->sk_cgrp_data);
+#endif
+#ifdef CONFIG_MEMCG
+	if (mem_cgroup_sockets_enabled && sk->sk_memcg != meta_sk->sk_memcg) {
+		/* Same as in inet_csk_accept, move what is already charged */
+		int amt = sk_mem_pages(sk->sk_forward_alloc +
+				       atomic_read(&sk->sk_rmem_alloc));
+
+		if (sk->sk_memcg && amt)
+			mem_cgroup_uncharge_skmem(sk->sk_memcg, amt);
+		mem_cgroup_sk_free(sk);
+
+		sk->sk_memcg = meta_sk->sk_memcg;
+		if (sk->sk_memcg) {
+			css_get(&sk->sk_memcg->css);
+			if (amt)
+				mem_cgroup_charge_skmem(sk->sk_memcg, amt);
+		}
+	}
+#endif
+}
+
 /* Called without holding lock on meta_sk */
 static void mptcp_sub_inherit_sockopts(const struct sock *meta_sk, struct sock *sub_sk)
 {
@@ -1173,6 +1378,10 @@ static void mptcp_init_buffer_space(struct sock *sk)
 	struct tcp_sock *meta_tp = tcp_sk(meta_sk);
 	int space;
 
+	/* Also the meta's init_buffer_space - path metrics are per subflow */
+	if (!is_meta_sk(sk))
+		mptcp_metrics_init_sub(sk);
+
 	tcp_init_buffer_space(sk);
 
 	if (is_master_tp(tp)) {
@@ -1283,6 +1492,264 @@ void mptcp_initialize_recv_vars(struct tcp_sock *meta_tp, struct mptcp_cb *mpcb,
 	meta_tp->snd_wl1 = meta_tp->rcv_nxt - 1;
 }
 
+/* Takes the references that are released at the end of mptcp_park_wq */
+static void mptcp_park_queue(struct mptcp_cb *mpcb, unsigned long delay)
+{
+	struct sock *meta_sk = mpcb->meta_sk;
+	bool pending;
+
+	sock_hold(meta_sk);
+	refcount_inc(&mpcb->mpcb_refcnt);
+
+	/* Re-activation must not wait for a pending idle-check */
+	if (delay)
+		pending = !queue_delayed_work_on(mptcp_work_cpu(mpcb, NULL),
+						 mptcp_conn_wq,
+						 &mpcb->park_work, delay);
+	else
+		pending = mod_delayed_work_on(mptcp_work_cpu(mpcb, NULL),
+					      mptcp_conn_wq, &mpcb->park_work,
+					      0);
+
+	if (pending) {
+		mptcp_mpcb_put(mpcb);
+		__sock_put(meta_sk);
+	}
+}
+
+static void mptcp_park_save(const struct sock *sk, struct mptcp_parked_sub *p)
+{
+	const struct tcp_sock *tp = tcp_sk(sk);
+
+	memset(p, 0, sizeof(*p));
+
+	p->loc_id = tp->mptcp->loc_id;
+	p->rem_id = tp->mptcp->rem_id;
+	p->low_prio = tp->mptcp->low_prio;
+	p->if_idx = sk->sk_bound_dev_if;
+	p->rem_port = inet_sk(sk)->inet_dport;
+
+	if (sk->sk_family == AF_INET || mptcp_v6_is_v4_mapped(sk)) {
+		p->family = AF_INET;
+		p->loc.in.s_addr = inet_sk(sk)->inet_saddr;
+		p->rem.in.s_addr = inet_sk(sk)->inet_daddr;
+#if IS_ENABLED(CONFIG_IPV6)
+	} else {
+		p->family = AF_INET6;
+		p->loc.in6 = inet6_sk(sk)->saddr;
+		p->rem.in6 = sk->sk_v6_daddr;
+#endif
+	}
+}
+
+/* Closes all but one subflow once the connection has been idle for
+ * sysctl_mptcp_idle_park. Their addresses are kept, so that they can be
+ * re-established by mptcp_unpark_subflows without a new ADD_ADDR.
+ */
+static void mptcp_park_subflows(struct sock *meta_sk)
+{
+	struct mptcp_cb *mpcb = tcp_sk(meta_sk)->mpcb;
+	unsigned long period = sysctl_mptcp_idle_park;
+	struct mptcp_tcp_sock *mptcp;
+	struct hlist_node *tmp;
+	u32 now = tcp_jiffies32, idle = U32_MAX;
+	struct sock *keep_sk;
+	int cnt = 0;
+
+	if (!period)
+		return;
+
+	mptcp_for_each_sub(mpcb, mptcp) {
+		struct sock *sk = mptcp_to_sock(mptcp);
+
+		idle = min3(idle, now - tcp_sk(sk)->lsndtime,
+			    now - inet_csk(sk)->icsk_ack.lrcvtime);
+	}
+
+	if (idle < period) {
+		mptcp_park_queue(mpcb, period - idle);
+		return;
+	}
+
+	/* Data is still in flight or about to be sent - not idle */
+	if (tcp_sk(meta_sk)->packets_out || tcp_send_head(meta_sk) ||
+	    !skb_queue_empty(&mpcb->reinject_queue)) {
+		mptcp_park_queue(mpcb, period);
+		return;
+	}
+
+	keep_sk = mptcp_select_ack_sock(meta_sk);
+	if (!keep_sk)
+		return;
+
+	mptcp_for_each_sub(mpcb, mptcp) {
+		struct sock *sk = mptcp_to_sock(mptcp);
+
+		if (sk != keep_sk && mptcp_sk_can_send(sk) &&
+		    !tcp_sk(sk)->closing)
+			cnt++;
+	}
+
+	if (!cnt)
+		return;
+
+	mpcb->parked = kcalloc(cnt, sizeof(*mpcb->parked), GFP_KERNEL);
+	if (!mpcb->parked)
+		return;
+
+	mptcp_for_each_sub_safe(mpcb, mptcp, tmp) {
+		struct sock *sk = mptcp_to_sock(mptcp);
+
+		if (sk == keep_sk || !mptcp_sk_can_send(sk) ||
+		    tcp_sk(sk)->closing)
+			continue;
+
+		mptcp_park_save(sk, &mpcb->parked[mpcb->parked_cnt++]);
+		mptcp_sub_close(sk, 0);
+
+		MPTCP_INC_STATS(sock_net(meta_sk), MPTCP_MIB_SUBPARKED);
+	}
+}
+
+static void mptcp_unpark_subflows(struct sock *meta_sk)
+{
+	struct mptcp_cb *mpcb = tcp_sk(meta_sk)->mpcb;
+	int i;
+
+	for (i = 0; i < mpcb->parked_cnt; i++) {
+		struct mptcp_parked_sub *p = &mpcb->parked[i];
+		int ret;
+
+		if (p->family == AF_INET) {
+			struct mptcp_loc4 loc = {
+				.loc4_id = p->loc_id,
+				.low_prio = p->low_prio,
+				.if_idx = p->if_idx,
+				.addr = p->loc.in,
+			};
+			struct mptcp_rem4 rem = {
+				.rem4_id = p->rem_id,
+				.port = p->rem_port,
+				.addr = p->rem.in,
+			};
+
+			ret = __mptcp_init4_subsockets(meta_sk, &loc, 0, &rem,
+						       NULL);
+#if IS_ENABLED(CONFIG_IPV6)
+		} else {
+			struct mptcp_loc6 loc = {
+				.loc6_id = p->loc_id,
+				.low_prio = p->low_prio,
+				.if_idx = p->if_idx,
+				.addr = p->loc.in6,
+			};
+			struct mptcp_rem6 rem = {
+				.rem6_id = p->rem_id,
+				.port = p->rem_port,
+				.addr = p->rem.in6,
+			};
+
+			ret = __mptcp_init6_subsockets(meta_sk, &loc, 0, &rem,
+						       NULL);
+#else
+		} else {
+			ret = -EAFNOSUPPORT;
+#endif
+		}
+
+		if (!ret)
+			MPTCP_INC_STATS(sock_net(meta_sk),
+					MPTCP_MIB_SUBUNPARKED);
+	}
+
+	kfree(mpcb->parked);
+	mpcb->parked = NULL;
+	mpcb->parked_cnt = 0;
+}
+
+static void mptcp_park_wq(struct work_struct *work)
+{
+	struct mptcp_cb *mpcb = container_of(work, struct mptcp_cb,
+					     park_work.work);
+	struct sock *meta_sk = mpcb->meta_sk;
+
+	mutex_lock(&mpcb->mpcb_mutex);
+	lock_sock_nested(meta_sk, SINGLE_DEPTH_NESTING);
+
+	if (sock_flag(meta_sk, SOCK_DEAD) || !mptcp(tcp_sk(meta_sk)) ||
+	    !mptcp_can_new_subflow(meta_sk))
+		goto exit;
+
+	if (mpcb->parked_cnt)
+		mptcp_unpark_subflows(meta_sk);
+	else
+		mptcp_park_subflows(meta_sk);
+
+exit:
+	mpcb->unpark_pending = 0;
+	release_sock(meta_sk);
+	mutex_unlock(&mpcb->mpcb_mutex);
+	mptcp_mpcb_put(mpcb);
+	sock_put(meta_sk);
+}
+
+/* Called from mptcp_write_xmit while subflows are parked. They are brought
+ * back as soon as the remaining ones would need more than
+ * sysctl_mptcp_unpark_latency (in ms) to drain what is queued.
+ */
+void mptcp_unpark_check(struct sock *meta_sk)
+{
+	const struct tcp_sock *meta_tp = tcp_sk(meta_sk);
+	struct mptcp_cb *mpcb = meta_tp->mpcb;
+	struct mptcp_tcp_sock *mptcp;
+	u64 rate = 0, queued;
+
+	if (mpcb->unpark_pending)
+		return;
+
+	queued = meta_tp->write_seq - meta_tp->snd_una;
+	if (!queued)
+		return;
+
+	mptcp_for_each_sub(mpcb, mptcp) {
+		const struct sock *sk = mptcp_to_sock(mptcp);
+		const struct tcp_sock *tp = tcp_sk(sk);
+
+		if (!mptcp_sk_can_send(sk) || !tp->srtt_us)
+			continue;
+
+		/* In bytes per second - srtt_us is left-shifted by 3 */
+		rate += div_u64((u64)tp->snd_cwnd * tp->mss_cache *
+				(USEC_PER_SEC << 3), tp->srtt_us);
+	}
+
+	if (rate && queued * MSEC_PER_SEC <= rate * sysctl_mptcp_unpark_latency)
+		return;
+
+	mpcb->unpark_pending = 1;
+	mptcp_park_queue(mpcb, 0);
+}
+
+/* Subflows that are cloned from the meta-socket (the master and passive
+ * MP_JOINs) copy its sk_user_data and sk_prot. If the meta is in a sockmap,
+ * those are its psock and the tcp_bpf proto - give them back the original
+ * proto, without a reference on the meta's psock.
+ */
+static void mptcp_sub_drop_psock(struct sock *sk)
+{
+#ifdef CONFIG_NET_SOCK_MSG
+	struct sk_psock *psock;
+
+	rcu_read_lock();
+	psock = sk_psock(sk);
+	if (psock && sk->sk_prot->recvmsg == tcp_bpf_recvmsg) {
+		sk->sk_prot = psock->sk_proto;
+		rcu_assign_sk_user_data(sk, NULL);
+	}
+	rcu_read_unlock();
+#endif
+}
+
 static int mptcp_alloc_mpcb(struct sock *meta_sk, __u64 remote_key,
 			    int rem_key_set, __u8 mptcp_ver, u32 window)
 {
@@ -1303,6 +1770,8 @@ static int mptcp_alloc_mpcb(struct sock *meta_sk, __u64 remote_key,
 	if (!master_sk)
 		goto err_alloc_master;
 
+	mptcp_sub_drop_psock(master_sk);
+
 	/* Same as in inet_csk_clone_lock - need to init to 0 */
 	memset(&inet_csk(master_sk)->icsk_accept_queue, 0,
 	       sizeof(inet_csk(master_sk)->icsk_accept_queue));
@@ -1332,6 +1801,10 @@ static int mptcp_alloc_mpcb(struct sock *meta_sk, __u64 remote_key,
 
 	skb_queue_head_init(&mpcb->reinject_queue);
 	mutex_init(&mpcb->mpcb_mutex);
+	INIT_DEFERRABLE_WORK(&mpcb->park_work, mptcp_park_wq);
+	init_llist_head(&mpcb->close_list);
+	INIT_WORK(&mpcb->close_work, mptcp_sub_close_batch_wq);
+	mpcb->app_cpu = -1;
 
 	/* Init time-wait stuff */
 	INIT_LIST_HEAD(&mpcb->tw_list);
@@ -1361,14 +1834,25 @@ static int mptcp_alloc_mpcb(struct sock *meta_sk, __u64 remote_key,
 		 * So, we need to check if someone else already added the token
 		 * and revert in that case. The other guy won the race...
 		 */
-		if (mptcp_find_token(mpcb->mptcp_loc_token)) {
+		if (mptcp_find_token_key(mpcb->mptcp_loc_token,
+					 mpcb->mptcp_loc_key)) {
 			spin_unlock(&mptcp_tk_hashlock);
 			local_bh_enable();
 			rcu_read_unlock();
 
 			goto err_insert_token;
 		}
-		__mptcp_hash_insert(meta_tp, mpcb->mptcp_loc_token);
+
+		/* With mptcp_lazy_token, another connection may have taken
+		 * the token since our SYN/ACK. The peer already derived it
+		 * from our key, so we can't pick a new one. Rather than
+		 * resetting, keep the connection without accepting MP_JOINs:
+		 * these find the other meta and fail its HMAC-check.
+		 */
+		if (mptcp_find_token(mpcb->mptcp_loc_token))
+			MPTCP_INC_STATS(sock_net(meta_sk), MPTCP_MIB_TOKENCOLLISION);
+		else
+			__mptcp_hash_insert(meta_tp, mpcb->mptcp_loc_token);
 
 		spin_unlock(&mptcp_tk_hashlock);
 		local_bh_enable();
@@ -1496,6 +1980,7 @@ static int mptcp_alloc_mpcb(struct sock *meta_sk, __u64 remote_key,
 
 	mptcp_mpcb_inherit_sockopts(meta_sk, master_sk);
 
+	mptcp_policy_apply(mpcb);
 	mptcp_init_path_manager(mpcb);
 	mptcp_init_scheduler(mpcb);
 
@@ -1573,6 +2058,7 @@ int mptcp_add_sock(struct sock *meta_sk, struct sock *sk, u8 loc_id, u8 rem_id,
 
 	tp->mptcp->loc_id = loc_id;
 	tp->mptcp->rem_id = rem_id;
+	mptcp_init_dss_tmpl(tp);
 	if (mpcb->sched_ops->init)
 		mpcb->sched_ops->init(sk);
 
@@ -1586,15 +2072,22 @@ int mptcp_add_sock(struct sock *meta_sk, struct sock *sk, u8 loc_id, u8 rem_id,
 	spin_lock_bh(&mpcb->mpcb_list_lock);
 	hlist_add_head_rcu(&tp->mptcp->node, &mpcb->conn_list);
 	spin_unlock_bh(&mpcb->mpcb_list_lock);
+	mpcb->sub_gen++;
 
 	tp->mptcp->attached = 1;
 
 	mptcp_sub_inherit_sockopts(meta_sk, sk);
+	mptcp_sub_inherit_cgroups(meta_sk, sk);
 	INIT_DELAYED_WORK(&tp->mptcp->work, mptcp_sub_close_wq);
 
 	/* Properly inherit CC from the meta-socket */
 	mptcp_assign_congestion_control(sk);
 
+	/* Only the client re-establishes subflows, thus only it can park */
+	if (sysctl_mptcp_idle_park && !mpcb->server_side &&
+	    mptcp_subflow_count(mpcb) > 1)
+		mptcp_park_queue(mpcb, sysctl_mptcp_idle_park);
+
 	/* As we successfully allocated the mptcp_tcp_sock, we have to
 	 * change the function-pointers here (for sk_destruct to work correctly)
 	 */
@@ -1641,6 +2134,8 @@ void mptcp_del_sock(struct sock *sk)
 	if (mpcb->pm_ops->delete_subflow)
 		mpcb->pm_ops->delete_subflow(sk);
 
+	mptcp_metrics_update(sk);
+
 	mptcp_debug("%s: Removing subsock tok %#x pi:%d state %d is_meta? %d\n",
 		    __func__, mpcb->mptcp_loc_token, tp->mptcp->path_index,
 		    sk->sk_state, is_meta_sk(sk));
@@ -1648,9 +2143,11 @@ void mptcp_del_sock(struct sock *sk)
 	spin_lock_bh(&mpcb->mpcb_list_lock);
 	hlist_del_init_rcu(&tp->mptcp->node);
 	spin_unlock_bh(&mpcb->mpcb_list_lock);
+	mpcb->sub_gen++;
 
 	tp->mptcp->attached = 0;
 	mpcb->path_index_bits &= ~(1 << tp->mptcp->path_index);
+	mpcb->cost_bytes_acked += tp->bytes_acked * tp->mptcp->cost;
 
 	if (!tcp_write_queue_empty(sk) || !tcp_rtx_queue_empty(sk))
 		mptcp_reinject_data(sk, 0);
@@ -1671,6 +2168,10 @@ void mptcp_del_sock(struct sock *sk)
 		mpcb->master_sk = NULL;
 	} else if (tp->mptcp->pre_established) {
 		sk_stop_timer(sk, &tp->mptcp->mptcp_ack_timer);
+
+		/* Its data has been reinjected above */
+		if (tp->mptcp->join_early_sent)
+			MPTCP_INC_STATS(sock_net(sk), MPTCP_MIB_JOINEARLYFAIL);
 	}
 }
 
@@ -1693,9 +2194,11 @@ void mptcp_update_metasocket(const struct sock *meta_sk)
 void mptcp_cleanup_rbuf(struct sock *meta_sk, int copied)
 {
 	struct tcp_sock *meta_tp = tcp_sk(meta_sk);
+	struct sock *ack_sk, *acked_sk = NULL;
 	bool recheck_rcv_window = false;
 	struct mptcp_tcp_sock *mptcp;
 	__u32 rcv_window_now = 0;
+	__u32 new_window;
 
 	if (copied > 0 && !(meta_sk->sk_shutdown & RCV_SHUTDOWN)) {
 		rcv_window_now = tcp_receive_window_now(meta_tp);
@@ -1732,13 +2235,20 @@ void mptcp_cleanup_rbuf(struct sock *meta_sk, int copied)
 		       !icsk->icsk_ack.pingpong)) &&
 		     !atomic_read(&meta_sk->sk_rmem_alloc))) {
 			tcp_send_ack(sk);
+			acked_sk = sk;
 			continue;
 		}
 
 second_part:
+		/* With ack-economy, the window-update is sent only once for
+		 * the whole connection - see below.
+		 */
+		if (sysctl_mptcp_ack_economy)
+			continue;
+
 		/* This here is the second part of tcp_cleanup_rbuf */
 		if (recheck_rcv_window) {
-			__u32 new_window = tp->ops->__select_window(sk);
+			new_window = tcp_ops___select_window(sk);
 
 			/* Send ACK now, if this read freed lots of space
 			 * in our buffer. Certainly, new_window is new window.
@@ -1746,10 +2256,36 @@ void mptcp_cleanup_rbuf(struct sock *meta_sk, int copied)
 			 * current one.
 			 * "Lots" means "at least twice" here.
 			 */
-			if (new_window && new_window >= 2 * rcv_window_now)
+			if (new_window && new_window >= 2 * rcv_window_now) {
 				tcp_send_ack(sk);
+				MPTCP_INC_STATS(sock_net(meta_sk),
+						MPTCP_MIB_WINUPDATETX);
+			}
 		}
 	}
+
+	if (!recheck_rcv_window || !sysctl_mptcp_ack_economy)
+		return;
+
+	ack_sk = acked_sk ? : mptcp_select_ack_sock(meta_sk);
+	if (!ack_sk)
+		return;
+
+	new_window = tcp_ops___select_window(ack_sk);
+	if (!new_window || new_window < 2 * rcv_window_now)
+		return;
+
+	/* The receive-window and the DATA_ACK are connection-level. Any ACK
+	 * we sent above already carried them (and updated the meta's
+	 * rcv_wnd), so there is no need for yet another one.
+	 */
+	if (acked_sk) {
+		MPTCP_INC_STATS(sock_net(meta_sk), MPTCP_MIB_WINUPDATESAVED);
+		return;
+	}
+
+	tcp_send_ack(ack_sk);
+	MPTCP_INC_STATS(sock_net(meta_sk), MPTCP_MIB_WINUPDATETX);
 }
 
 static int mptcp_sub_send_fin(struct sock *sk)
@@ -1820,10 +2356,56 @@ void mptcp_sub_close_wq(struct work_struct *work)
 	sock_put(sk);
 }
 
+/* Closes all the subflows that got queued on the mpcb since the last run.
+ * During mass-disconnects, this makes one work-item per connection instead
+ * of one per subflow.
+ */
+void mptcp_sub_close_batch_wq(struct work_struct *work)
+{
+	struct mptcp_cb *mpcb = container_of(work, struct mptcp_cb, close_work);
+	struct sock *meta_sk = mpcb->meta_sk;
+	struct mptcp_tcp_sock *mptcp, *tmp;
+	struct llist_node *list;
+	int n = 0;
+
+	mutex_lock(&mpcb->mpcb_mutex);
+	lock_sock_nested(meta_sk, SINGLE_DEPTH_NESTING);
+
+	list = llist_del_all(&mpcb->close_list);
+	llist_for_each_entry(mptcp, list, close_node) {
+		mptcp_sub_close_doit(mptcp_to_sock(mptcp));
+		n++;
+	}
+
+	release_sock(meta_sk);
+	mutex_unlock(&mpcb->mpcb_mutex);
+
+	while (n--)
+		mptcp_mpcb_put(mpcb);
+
+	/* Same order as mptcp_sub_close_wq - the last reference of a subflow
+	 * drops one of the meta-socket.
+	 */
+	llist_for_each_entry_safe(mptcp, tmp, list, close_node) {
+		struct sock *sk = mptcp_to_sock(mptcp);
+
+		/* Only now, so that mptcp_sub_close can't re-queue it while
+		 * we are walking the list.
+		 */
+		mptcp->close_pending = 0;
+		sock_put(sk);
+	}
+
+	/* The references of the work itself */
+	mptcp_mpcb_put(mpcb);
+	sock_put(meta_sk);
+}
+
 void mptcp_sub_close(struct sock *sk, unsigned long delay)
 {
 	struct tcp_sock *tp = tcp_sk(sk);
 	struct delayed_work *work = &tcp_sk(sk)->mptcp->work;
+	struct mptcp_cb *mpcb = tp->mpcb;
 
 	/* We are already closing - e.g., call from sock_def_error_report upon
 	 * tcp_disconnect in tcp_close.
@@ -1831,6 +2413,10 @@ void mptcp_sub_close(struct sock *sk, unsigned long delay)
 	if (tp->closing)
 		return;
 
+	/* Already queued for the batched close, which is as early as it gets */
+	if (tp->mptcp->close_pending)
+		return;
+
 	/* Work already scheduled ? */
 	if (work_pending(&work->work)) {
 		/* Work present - who will be first ? */
@@ -1860,11 +2446,29 @@ void mptcp_sub_close(struct sock *sk, unsigned long delay)
 				TCP_INC_STATS(sock_net(sk), TCP_MIB_CURRESTAB);
 			sk->sk_state = old_state;
 		}
+
+		sock_hold(sk);
+		refcount_inc(&mpcb->mpcb_refcnt);
+		tp->mptcp->close_pending = 1;
+		llist_add(&tp->mptcp->close_node, &mpcb->close_list);
+
+		/* The work holds its own references, taken before queueing it
+		 * so that it can't run and drop them before we took them.
+		 */
+		sock_hold(mpcb->meta_sk);
+		refcount_inc(&mpcb->mpcb_refcnt);
+		if (!queue_work_on(mptcp_work_cpu(mpcb, NULL), mptcp_conn_wq,
+				   &mpcb->close_work)) {
+			mptcp_mpcb_put(mpcb);
+			__sock_put(mpcb->meta_sk);
+		}
+		return;
 	}
 
 	sock_hold(sk);
-	refcount_inc(&tp->mpcb->mpcb_refcnt);
-	queue_delayed_work(mptcp_wq, work, delay);
+	refcount_inc(&mpcb->mpcb_refcnt);
+	queue_delayed_work_on(mptcp_work_cpu(mpcb, sk), mptcp_conn_wq, work,
+			      delay);
 }
 
 void mptcp_sub_force_close(struct sock *sk)
@@ -1938,6 +2542,11 @@ void mptcp_close(struct sock *meta_sk, long timeout)
 	mutex_lock(&mpcb->mpcb_mutex);
 	lock_sock_nested(meta_sk, SINGLE_DEPTH_NESTING);
 
+	if (cancel_delayed_work(&mpcb->park_work)) {
+		mptcp_mpcb_put(mpcb);
+		__sock_put(meta_sk);
+	}
+
 	if (meta_tp->inside_tk_table)
 		/* Detach the mpcb from the token hashtable */
 		mptcp_hash_remove_bh(meta_tp);
@@ -2274,6 +2883,7 @@ static int __mptcp_check_req_master(struct sock *child,
 	child_tp->mptcp->rcv_isn = tcp_rsk(req)->rcv_isn;
 
 	mpcb->dss_csum = mtreq->dss_csum;
+	mptcp_init_dss_tmpl(child_tp);
 	mpcb->server_side = 1;
 
 	/* Needs to be done here additionally, because when accepting a
@@ -2396,6 +3006,9 @@ struct sock *mptcp_check_req_child(struct sock *meta_sk,
 	struct tcp_sock *child_tp = tcp_sk(child);
 	u8 hash_mac_check[SHA256_DIGEST_SIZE];
 
+	/* Before anything, even the teardown, can reach the inherited proto */
+	mptcp_sub_drop_psock(child);
+
 	if (!mopt->join_ack) {
 		MPTCP_INC_STATS(sock_net(meta_sk), MPTCP_MIB_JOINACKFAIL);
 		goto teardown;
@@ -2811,6 +3424,7 @@ static void __mptcp_get_info(const struct sock *meta_sk,
 {
 	const struct inet_connection_sock *meta_icsk = inet_csk(meta_sk);
 	const struct tcp_sock *meta_tp = tcp_sk(meta_sk);
+	struct mptcp_tcp_sock *mptcp;
 	u32 now = tcp_jiffies32;
 
 	memset(info, 0, sizeof(*info));
@@ -2832,6 +3446,16 @@ static void __mptcp_get_info(const struct sock *meta_sk,
 
 	info->mptcpi_bytes_acked = meta_tp->bytes_acked;
 	info->mptcpi_bytes_received = meta_tp->bytes_received;
+
+	info->mptcpi_pure_acks_sent = meta_tp->mpcb->pure_acks_sent;
+
+	info->mptcpi_cost_bytes = meta_tp->mpcb->cost_bytes_acked;
+	mptcp_for_each_sub(meta_tp->mpcb, mptcp)
+		info->mptcpi_cost_bytes += mptcp->tp->bytes_acked * mptcp->cost;
+
+	info->mptcpi_opti_retrans = meta_tp->mpcb->opti_retrans;
+	info->mptcpi_opti_penal = meta_tp->mpcb->opti_penal;
+	info->mptcpi_opti_retrans_bytes = meta_tp->mpcb->opti_retrans_bytes;
 }
 
 static void mptcp_get_sub_info(struct sock *sk, struct mptcp_sub_info *info)
@@ -2990,6 +3614,280 @@ int mptcp_get_info(const struct sock *meta_sk, char __user *optval, int optlen)
 	return 0;
 }
 
+/* Called from the application's system-calls, with the meta-lock held.
+ * Steers the subflows' RX to this CPU through RFS and records it, so that
+ * the transmit-queues and the work-items of the connection follow.
+ */
+void mptcp_record_flow(struct sock *meta_sk)
+{
+	struct mptcp_cb *mpcb = tcp_sk(meta_sk)->mpcb;
+	int affinity = sysctl_mptcp_cpu_affinity;
+	int cpu = raw_smp_processor_id();
+	struct mptcp_tcp_sock *mptcp;
+	bool moved;
+
+	moved = mpcb->app_cpu != cpu;
+	WRITE_ONCE(mpcb->app_cpu, cpu);
+
+	mptcp_for_each_sub(mpcb, mptcp) {
+		struct sock *sk = mptcp_to_sock(mptcp);
+
+		/* When spreading, RSS already distributes the subflows
+		 * by their hash.
+		 */
+		if (affinity != MPTCP_CPU_AFFINITY_SPREAD)
+			sock_rps_record_flow(sk);
+
+		/* XPS picks the queue of the new CPU with the next segment
+		 * that is allowed to be reordered.
+		 */
+		if (moved && affinity == MPTCP_CPU_AFFINITY_APP)
+			sk_tx_queue_clear(sk);
+	}
+}
+
+/* CPU on which to queue the work-items of subflow sk, or of the whole
+ * connection if sk is NULL. Only meaningful on mptcp_conn_wq - an unbound
+ * workqueue would just pick the CPU's NUMA-node.
+ */
+int mptcp_work_cpu(const struct mptcp_cb *mpcb, const struct sock *sk)
+{
+	int affinity = sysctl_mptcp_cpu_affinity;
+	int cpu = READ_ONCE(mpcb->app_cpu);
+
+	if (!affinity || cpu < 0)
+		return WORK_CPU_UNBOUND;
+
+	if (affinity == MPTCP_CPU_AFFINITY_SPREAD && sk) {
+		int n = tcp_sk(sk)->mptcp->path_index % num_online_cpus();
+
+		while (n--) {
+			cpu = cpumask_next(cpu, cpu_online_mask);
+			if (cpu >= nr_cpu_ids)
+				cpu = cpumask_first(cpu_online_mask);
+		}
+	}
+
+	if (cpu >= nr_cpu_ids || !cpu_online(cpu))
+		return WORK_CPU_UNBOUND;
+
+	return cpu;
+}
+EXPORT_SYMBOL(mptcp_work_cpu);
+
+#ifdef CONFIG_BPF
+/* Called from tcp_call_bpf, gives sock_ops programs the connection of sk
+ * and, for a subflow, its identifiers.
+ *
+ * Like the rest of the subflow's processing, the callbacks run with the
+ * meta-socket locked - owned by user or bh-locked - not the subflow itself.
+ */
+void mptcp_init_sock_ops(struct bpf_sock_ops_kern *sock_ops, struct sock *sk)
+{
+	const struct tcp_sock *tp = tcp_sk(sk);
+
+	sock_ops->meta_sk = mptcp_meta_sk(sk);
+	sock_owned_by_me(sock_ops->meta_sk);
+
+	if (is_meta_sk(sk)) {
+		sock_ops->mptcp_flags = BPF_SOCK_OPS_MPTCP_F_META;
+		return;
+	}
+
+	if (!tp->mptcp)
+		return;
+
+	sock_ops->mptcp_path_index = tp->mptcp->path_index;
+	sock_ops->mptcp_loc_id = tp->mptcp->loc_id;
+	sock_ops->mptcp_rem_id = tp->mptcp->rem_id;
+
+	if (is_master_tp(tp))
+		sock_ops->mptcp_flags |= BPF_SOCK_OPS_MPTCP_F_MASTER;
+	if (tp->mptcp->low_prio || tp->mptcp->rcv_low_prio)
+		sock_ops->mptcp_flags |= BPF_SOCK_OPS_MPTCP_F_LOW_PRIO;
+	if (tp->mptcp->fully_established)
+		sock_ops->mptcp_flags |= BPF_SOCK_OPS_MPTCP_F_FULLY_ESTAB;
+}
+EXPORT_SYMBOL(mptcp_init_sock_ops);
+#endif
+
+static void mptcp_get_meta_ext(const struct sock *meta_sk,
+			       struct mptcp_meta_ext *ext)
+{
+	const struct tcp_sock *meta_tp = tcp_sk(meta_sk);
+	const struct mptcp_cb *mpcb = meta_tp->mpcb;
+	const struct sk_buff *skb;
+	struct mptcp_tcp_sock *mptcp;
+
+	memset(ext, 0, sizeof(*ext));
+
+	ext->snd_una = meta_tp->snd_una;
+	ext->snd_nxt = meta_tp->snd_nxt;
+	ext->rcv_nxt = meta_tp->rcv_nxt;
+	ext->snd_wnd = meta_tp->snd_wnd;
+
+	skb = skb_rb_last(&meta_tp->out_of_order_queue);
+	if (skb)
+		ext->ofo_bytes = TCP_SKB_CB(skb)->end_seq - meta_tp->rcv_nxt;
+
+	skb = tcp_rtx_queue_head(meta_sk);
+	if (skb)
+		ext->peer_ofo = mptcp_ofo_occupancy(meta_tp, skb);
+
+	ext->reinject_queued = skb_queue_len(&mpcb->reinject_queue);
+	ext->reinjects_sent = mpcb->reinjects_sent;
+
+	ext->sub_gen = mpcb->sub_gen;
+	mptcp_for_each_sub(mpcb, mptcp)
+		ext->sub_cnt++;
+
+	strncpy(ext->sched, mpcb->sched_ops->name, sizeof(ext->sched) - 1);
+}
+
+static void mptcp_get_sub_ext(struct sock *sk, struct mptcp_sub_ext *ext)
+{
+	const struct tcp_sock *tp = tcp_sk(sk);
+	const struct mptcp_tcp_sock *mptcp = tp->mptcp;
+
+	memset(ext, 0, sizeof(*ext));
+
+	mptcp_get_sub_info(sk, &ext->addrs);
+
+	ext->path_index = mptcp->path_index;
+	ext->loc_id = mptcp->loc_id;
+	ext->rem_id = mptcp->rem_id;
+
+	if (mptcp->low_prio)
+		ext->flags |= MPTCP_SUB_EXT_F_BACKUP;
+	if (mptcp->rcv_low_prio)
+		ext->flags |= MPTCP_SUB_EXT_F_RCV_BACKUP;
+	if (mptcp->fully_established)
+		ext->flags |= MPTCP_SUB_EXT_F_FULLY_EST;
+	if (mptcp->pre_established)
+		ext->flags |= MPTCP_SUB_EXT_F_PRE_EST;
+	if (sk == tp->mpcb->master_sk)
+		ext->flags |= MPTCP_SUB_EXT_F_MASTER;
+
+	ext->state = sk->sk_state;
+	ext->ca_state = inet_csk(sk)->icsk_ca_state;
+
+	ext->srtt_us = tp->srtt_us >> 3;
+	ext->rttvar_us = tp->mdev_us >> 2;
+	ext->snd_cwnd = tp->snd_cwnd;
+	ext->snd_ssthresh = tp->snd_ssthresh;
+	ext->packets_out = tp->packets_out;
+	ext->retrans_out = tp->retrans_out;
+	ext->total_retrans = tp->total_retrans;
+	ext->data_segs_out = tp->data_segs_out;
+
+	ext->delivery_rate = mptcp_sub_rate(tp);
+	ext->bytes_acked = tp->bytes_acked;
+	ext->bytes_received = tp->bytes_received;
+	ext->last_active_us = tp->tcp_mstamp;
+}
+
+/* Everything is filled in a single pass over the subflows, straight into
+ * the user's buffers. With MPTCP_INFO_EXT_F_CHANGED, subflows that did not
+ * send nor receive anything since the cookie was handed out are skipped.
+ * Callers notice added or removed subflows through meta->sub_gen.
+ */
+int mptcp_get_info_ext(const struct sock *meta_sk, char __user *optval,
+		       int optlen)
+{
+	const struct tcp_sock *meta_tp = tcp_sk(meta_sk);
+	struct mptcp_info_ext m_info;
+	u64 now = tcp_clock_us();
+	u64 since = 0;
+
+	/* Check again with the lock held */
+	if (!mptcp(meta_tp))
+		return -EINVAL;
+
+	memset(&m_info, 0, sizeof(m_info));
+	if (copy_from_user(&m_info, optval, optlen))
+		return -EFAULT;
+
+	if (m_info.flags & ~MPTCP_INFO_EXT_F_CHANGED)
+		return -EINVAL;
+
+	if (m_info.flags & MPTCP_INFO_EXT_F_CHANGED)
+		since = m_info.cookie;
+
+	m_info.version = MPTCP_INFO_EXT_VERSION;
+	m_info.cookie = now;
+
+	if (m_info.info) {
+		struct mptcp_meta_info meta_info;
+
+		__mptcp_get_info(meta_sk, &meta_info);
+
+		m_info.info_len = min_t(unsigned int, m_info.info_len,
+					sizeof(meta_info));
+		if (copy_to_user((void __user *)m_info.info, &meta_info,
+				 m_info.info_len))
+			return -EFAULT;
+	} else {
+		m_info.info_len = 0;
+	}
+
+	if (m_info.meta) {
+		struct mptcp_meta_ext meta_ext;
+
+		mptcp_get_meta_ext(meta_sk, &meta_ext);
+
+		m_info.meta_len = min_t(unsigned int, m_info.meta_len,
+					sizeof(meta_ext));
+		if (copy_to_user((void __user *)m_info.meta, &meta_ext,
+				 m_info.meta_len))
+			return -EFAULT;
+	} else {
+		m_info.meta_len = 0;
+	}
+
+	m_info.sub_len = min_t(unsigned int, m_info.sub_len,
+			       sizeof(struct mptcp_sub_ext));
+
+	if (m_info.subflows && m_info.sub_len) {
+		char __user *ptr = (char __user *)m_info.subflows;
+		unsigned int cnt = 0, total = 0;
+		struct mptcp_tcp_sock *mptcp;
+
+		mptcp_for_each_sub(meta_tp->mpcb, mptcp) {
+			struct sock *sk = mptcp_to_sock(mptcp);
+			struct mptcp_sub_ext sub_ext;
+
+			total++;
+
+			if (cnt == m_info.sub_cnt ||
+			    tcp_sk(sk)->tcp_mstamp < since)
+				continue;
+
+			mptcp_get_sub_ext(sk, &sub_ext);
+
+			if (copy_to_user(ptr, &sub_ext, m_info.sub_len))
+				return -EFAULT;
+
+			ptr += m_info.sub_len;
+			cnt++;
+		}
+
+		m_info.sub_cnt = cnt;
+		m_info.sub_total = total;
+	} else {
+		struct mptcp_tcp_sock *mptcp;
+
+		m_info.sub_cnt = 0;
+		m_info.sub_total = 0;
+		mptcp_for_each_sub(meta_tp->mpcb, mptcp)
+			m_info.sub_total++;
+	}
+
+	if (copy_to_user(optval, &m_info, optlen))
+		return -EFAULT;
+
+	return 0;
+}
+
 void mptcp_clear_sk(struct sock *sk, int size)
 {
 	struct tcp_sock *tp = tcp_sk(sk);
@@ -3044,11 +3942,24 @@ static const struct snmp_mib mptcp_snmp_list[] = {
 	SNMP_MIB_ITEM("RemAddrTx", MPTCP_MIB_REMADDRTX),
 	SNMP_MIB_ITEM("MPJoinAlternatePort", MPTCP_MIB_JOINALTERNATEPORT),
 	SNMP_MIB_ITEM("MPCurrEstab", MPTCP_MIB_CURRESTAB),
+	SNMP_MIB_ITEM("MPWinUpdateTx", MPTCP_MIB_WINUPDATETX),
+	SNMP_MIB_ITEM("MPWinUpdateSaved", MPTCP_MIB_WINUPDATESAVED),
+	SNMP_MIB_ITEM("MPSubParked", MPTCP_MIB_SUBPARKED),
+	SNMP_MIB_ITEM("MPSubUnparked", MPTCP_MIB_SUBUNPARKED),
+	SNMP_MIB_ITEM("MPJoinEarlyData", MPTCP_MIB_JOINEARLYDATA),
+	SNMP_MIB_ITEM("MPJoinEarlyDataFailed", MPTCP_MIB_JOINEARLYFAIL),
+	SNMP_MIB_ITEM("MPTokenCollision", MPTCP_MIB_TOKENCOLLISION),
+	SNMP_MIB_ITEM("MPOptiRetrans", MPTCP_MIB_OPTIRETRANS),
+	SNMP_MIB_ITEM("MPOptiRetransBytes", MPTCP_MIB_OPTIRETRANSBYTES),
+	SNMP_MIB_ITEM("MPOptiPenalization", MPTCP_MIB_OPTIPENAL),
 	SNMP_MIB_SENTINEL
 };
 
 struct workqueue_struct *mptcp_wq;
 EXPORT_SYMBOL(mptcp_wq);
+/* Per-CPU, for the work-items of a connection, see mptcp_work_cpu() */
+struct workqueue_struct *mptcp_conn_wq;
+EXPORT_SYMBOL(mptcp_conn_wq);
 
 /* Output /proc/net/mptcp */
 static int mptcp_pm_seq_show(struct seq_file *seq, void *v)
@@ -3228,6 +4139,10 @@ void __init mptcp_init(void)
 	if (!mptcp_wq)
 		goto alloc_workqueue_failed;
 
+	mptcp_conn_wq = alloc_workqueue("mptcp_conn_wq", WQ_MEM_RECLAIM, 0);
+	if (!mptcp_conn_wq)
+		goto alloc_conn_workqueue_failed;
+
 	mptcp_tk_htable.hashtable =
 		alloc_large_system_hash("MPTCP tokens",
 					sizeof(mptcp_tk_htable.hashtable[0]),
@@ -3262,6 +4177,12 @@ void __init mptcp_init(void)
 	if (register_pernet_subsys(&mptcp_pm_proc_ops))
 		goto pernet_failed;
 
+	if (mptcp_metrics_init())
+		goto mptcp_metrics_failed;
+
+	if (mptcp_policy_init())
+		goto mptcp_policy_failed;
+
 #if IS_ENABLED(CONFIG_IPV6)
 	if (mptcp_pm_v6_init())
 		goto mptcp_pm_v6_failed;
@@ -3296,8 +4217,14 @@ void __init mptcp_init(void)
 	mptcp_pm_v6_undo();
 mptcp_pm_v6_failed:
 #endif
+	mptcp_policy_undo();
+mptcp_policy_failed:
+	mptcp_metrics_undo();
+mptcp_metrics_failed:
 	unregister_pernet_subsys(&mptcp_pm_proc_ops);
 pernet_failed:
+	destroy_workqueue(mptcp_conn_wq);
+alloc_conn_workqueue_failed:
 	destroy_workqueue(mptcp_wq);
 alloc_workqueue_failed:
 	kmem_cache_destroy(mptcp_tw_cache);
@@ -0,0 +1,339 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ *	MPTCP implementation - Coupled DataCenter TCP (DCTCP)
+ *
+ *	Every subflow keeps its own DCTCP-alpha, estimated from the fraction
+ *	of CE-marked bytes that got acknowledged on it, and reduces its window
+ *	by alpha / 2 upon ECE - as tcp_dctcp.c does.
+ *
+ *	The window-increase is coupled across the subflows like LIA does
+ *	(see mptcp_ccc_recalc_alpha()), so that they are together not more
+ *	aggressive than a single DCTCP-flow on the best path. A subflow that
+ *	sees more marking reduces more often and by more, while the increase
+ *	goes to the subflows with the best cwnd/rtt^2, thus traffic moves away
+ *	from it.
+ *
+ *	This program is free software; you can redistribute it and/or
+ *      modify it under the terms of the GNU General Public License
+ *      as published by the Free Software Foundation; either version
+ *      2 of the License, or (at your option) any later version.
+ */
+
+#include <linux/inet_diag.h>
+#include <linux/module.h>
+#include <net/mptcp.h>
+#include <net/tcp.h>
+#include "../ipv4/tcp_dctcp.h"
+
+#define MPDCTCP_MAX_ALPHA	1024U
+
+/* Same scaling of the coupled increase as LIA */
+static int alpha_scale_den = 10;
+static int alpha_scale_num = 32;
+static int alpha_scale = 12;
+
+static unsigned int mpdctcp_shift_g __read_mostly = 4; /* g = 1/2^4 */
+module_param(mpdctcp_shift_g, uint, 0644);
+MODULE_PARM_DESC(mpdctcp_shift_g, "parameter g for updating the per-subflow dctcp_alpha");
+
+static unsigned int mpdctcp_alpha_on_init __read_mostly = MPDCTCP_MAX_ALPHA;
+module_param(mpdctcp_alpha_on_init, uint, 0644);
+MODULE_PARM_DESC(mpdctcp_alpha_on_init, "parameter for initial dctcp_alpha value");
+
+struct mpdctcp {
+	u64	lia_alpha;	/* Coupled increase, computed over a cluster */
+	u32	old_delivered;
+	u32	old_delivered_ce;
+	u32	prior_rcv_nxt;
+	u32	dctcp_alpha;	/* Fraction of marked bytes, per subflow */
+	u32	next_seq;
+	u32	ce_state;
+	u32	loss_cwnd;
+	u32	cc_gen;		/* mpcb->cc_gen lia_alpha was computed at */
+};
+
+static inline struct mpdctcp *mpdctcp_ca(const struct sock *sk)
+{
+	return (struct mpdctcp *)inet_csk_ca(sk);
+}
+
+static inline int mpdctcp_sk_can_send(const struct sock *sk)
+{
+	return mptcp_sk_can_send(sk) && tcp_sk(sk)->srtt_us;
+}
+
+static inline u64 mpdctcp_scale(u32 val, int scale)
+{
+	return (u64) val << scale;
+}
+
+/* The alpha of LIA, computed among the subflows coupled with sk. Only sk's
+ * own lia_alpha gets updated, its cluster picks up the change through
+ * mpcb->cc_gen.
+ */
+static void mpdctcp_recalc_alpha(const struct sock *sk)
+{
+	const struct mptcp_cb *mpcb = tcp_sk(sk)->mpcb;
+	const struct mptcp_tcp_sock *mptcp;
+	u32 best_cwnd = 0, best_rtt = 0;
+	u64 max_numerator = 0, sum_denominator = 0, alpha = 1;
+
+	if (!mpcb)
+		return;
+
+	mptcp_for_each_sub(mpcb, mptcp) {
+		const struct sock *sub_sk = mptcp_to_sock(mptcp);
+		const struct tcp_sock *sub_tp = tcp_sk(sub_sk);
+		u64 tmp;
+
+		if (!mpdctcp_sk_can_send(sub_sk) ||
+		    !mptcp_sbd_coupled(sk, sub_sk))
+			continue;
+
+		tmp = div64_u64(mpdctcp_scale(sub_tp->snd_cwnd, alpha_scale_num),
+				(u64)sub_tp->srtt_us * sub_tp->srtt_us);
+		if (tmp >= max_numerator) {
+			max_numerator = tmp;
+			best_cwnd = sub_tp->snd_cwnd;
+			best_rtt = sub_tp->srtt_us;
+		}
+	}
+
+	/* No subflow is able to send - we don't care anymore */
+	if (unlikely(!best_rtt))
+		goto exit;
+
+	mptcp_for_each_sub(mpcb, mptcp) {
+		const struct sock *sub_sk = mptcp_to_sock(mptcp);
+		const struct tcp_sock *sub_tp = tcp_sk(sub_sk);
+
+		if (!mpdctcp_sk_can_send(sub_sk) ||
+		    !mptcp_sbd_coupled(sk, sub_sk))
+			continue;
+
+		sum_denominator += div_u64(mpdctcp_scale(sub_tp->snd_cwnd,
+							 alpha_scale_den) * best_rtt,
+					   sub_tp->srtt_us);
+	}
+	sum_denominator *= sum_denominator;
+	if (unlikely(!sum_denominator))
+		goto exit;
+
+	alpha = div64_u64(mpdctcp_scale(best_cwnd, alpha_scale_num),
+			  sum_denominator);
+	if (unlikely(!alpha))
+		alpha = 1;
+
+exit:
+	mpdctcp_ca(sk)->lia_alpha = alpha;
+}
+
+static void mpdctcp_reset(const struct tcp_sock *tp, struct mpdctcp *ca)
+{
+	ca->next_seq = tp->snd_nxt;
+
+	ca->old_delivered = tp->delivered;
+	ca->old_delivered_ce = tp->delivered_ce;
+}
+
+static void mpdctcp_init(struct sock *sk)
+{
+	const struct tcp_sock *tp = tcp_sk(sk);
+	struct mpdctcp *ca = mpdctcp_ca(sk);
+
+	ca->lia_alpha = 1;
+	ca->cc_gen = tp->mpcb ? tp->mpcb->cc_gen : 0;
+	ca->prior_rcv_nxt = tp->rcv_nxt;
+	ca->dctcp_alpha = min(mpdctcp_alpha_on_init, MPDCTCP_MAX_ALPHA);
+	ca->loss_cwnd = 0;
+	ca->ce_state = 0;
+	mpdctcp_reset(tp, ca);
+
+	/* Without ECN on this subflow, we only keep the coupled increase and
+	 * the halving upon loss. ECT was set during the handshake, clear it.
+	 */
+	if (!(tp->ecn_flags & TCP_ECN_OK) &&
+	    sk->sk_state != TCP_LISTEN && sk->sk_state != TCP_CLOSE) {
+		ca->dctcp_alpha = 0;
+		INET_ECN_dontxmit(sk);
+	}
+}
+
+static u32 mpdctcp_ssthresh(struct sock *sk)
+{
+	struct mpdctcp *ca = mpdctcp_ca(sk);
+	struct tcp_sock *tp = tcp_sk(sk);
+
+	ca->loss_cwnd = tp->snd_cwnd;
+	return max(tp->snd_cwnd - ((tp->snd_cwnd * ca->dctcp_alpha) >> 11U), 2U);
+}
+
+static void mpdctcp_update_alpha(struct sock *sk, u32 flags)
+{
+	const struct tcp_sock *tp = tcp_sk(sk);
+	struct mpdctcp *ca = mpdctcp_ca(sk);
+
+	/* Expired RTT */
+	if (!before(tp->snd_una, ca->next_seq)) {
+		u32 delivered_ce = tp->delivered_ce - ca->old_delivered_ce;
+		u32 alpha = ca->dctcp_alpha;
+
+		/* alpha = (1 - g) * alpha + g * F */
+		alpha -= min_not_zero(alpha, alpha >> mpdctcp_shift_g);
+		if (delivered_ce) {
+			u32 delivered = tp->delivered - ca->old_delivered;
+
+			delivered_ce <<= (10 - mpdctcp_shift_g);
+			delivered_ce /= max(1U, delivered);
+
+			alpha = min(alpha + delivered_ce, MPDCTCP_MAX_ALPHA);
+		}
+		WRITE_ONCE(ca->dctcp_alpha, alpha);
+		mpdctcp_reset(tp, ca);
+	}
+}
+
+static void mpdctcp_react_to_loss(struct sock *sk)
+{
+	struct mpdctcp *ca = mpdctcp_ca(sk);
+	struct tcp_sock *tp = tcp_sk(sk);
+
+	ca->loss_cwnd = tp->snd_cwnd;
+	tp->snd_ssthresh = max(tp->snd_cwnd >> 1U, 2U);
+}
+
+static void mpdctcp_set_state(struct sock *sk, u8 new_state)
+{
+	if (new_state == TCP_CA_Recovery &&
+	    new_state != inet_csk(sk)->icsk_ca_state)
+		mpdctcp_react_to_loss(sk);
+
+	if (!mptcp(tcp_sk(sk)))
+		return;
+
+	/* The windows changed - the cluster recomputes its coupled increase */
+	tcp_sk(sk)->mpcb->cc_gen++;
+}
+
+static void mpdctcp_cwnd_event(struct sock *sk, enum tcp_ca_event ev)
+{
+	struct mpdctcp *ca = mpdctcp_ca(sk);
+
+	switch (ev) {
+	case CA_EVENT_ECN_IS_CE:
+	case CA_EVENT_ECN_NO_CE:
+		dctcp_ece_ack_update(sk, ev, &ca->prior_rcv_nxt, &ca->ce_state);
+		break;
+	case CA_EVENT_LOSS:
+		mpdctcp_react_to_loss(sk);
+		if (mptcp(tcp_sk(sk)))
+			mpdctcp_recalc_alpha(sk);
+		break;
+	default:
+		break;
+	}
+}
+
+static void mpdctcp_cong_avoid(struct sock *sk, u32 ack, u32 acked)
+{
+	struct tcp_sock *tp = tcp_sk(sk);
+	struct mpdctcp *ca = mpdctcp_ca(sk);
+	u32 snd_cwnd;
+
+	if (!mptcp(tp)) {
+		tcp_reno_cong_avoid(sk, ack, acked);
+		return;
+	}
+
+	if (!tcp_is_cwnd_limited(sk))
+		return;
+
+	if (tcp_in_slow_start(tp)) {
+		tcp_slow_start(tp, acked);
+		mpdctcp_recalc_alpha(sk);
+		return;
+	}
+
+	if (ca->cc_gen != tp->mpcb->cc_gen) {
+		mpdctcp_recalc_alpha(sk);
+		ca->cc_gen = tp->mpcb->cc_gen;
+	}
+
+	/* Increase by min(lia_alpha / tot_cwnd, 1 / cwnd) per ack */
+	snd_cwnd = (u32)div64_u64(mpdctcp_scale(1, alpha_scale),
+				  ca->lia_alpha ? : 1);
+	snd_cwnd = max(snd_cwnd, tp->snd_cwnd);
+
+	if (tp->snd_cwnd_cnt >= snd_cwnd) {
+		if (tp->snd_cwnd < tp->snd_cwnd_clamp) {
+			tp->snd_cwnd++;
+			mpdctcp_recalc_alpha(sk);
+		}
+		tp->snd_cwnd_cnt = 0;
+	} else {
+		tp->snd_cwnd_cnt++;
+	}
+}
+
+static u32 mpdctcp_cwnd_undo(struct sock *sk)
+{
+	return max(tcp_sk(sk)->snd_cwnd, mpdctcp_ca(sk)->loss_cwnd);
+}
+
+static size_t mpdctcp_get_info(struct sock *sk, u32 ext, int *attr,
+			       union tcp_cc_info *info)
+{
+	const struct mpdctcp *ca = mpdctcp_ca(sk);
+	const struct tcp_sock *tp = tcp_sk(sk);
+
+	if (ext & (1 << (INET_DIAG_DCTCPINFO - 1)) ||
+	    ext & (1 << (INET_DIAG_VEGASINFO - 1))) {
+		memset(&info->dctcp, 0, sizeof(info->dctcp));
+		if (tp->ecn_flags & TCP_ECN_OK) {
+			info->dctcp.dctcp_enabled = 1;
+			info->dctcp.dctcp_ce_state = (u16)ca->ce_state;
+			info->dctcp.dctcp_alpha = ca->dctcp_alpha;
+			info->dctcp.dctcp_ab_ecn = tp->mss_cache *
+						   (tp->delivered_ce - ca->old_delivered_ce);
+			info->dctcp.dctcp_ab_tot = tp->mss_cache *
+						   (tp->delivered - ca->old_delivered);
+		}
+
+		*attr = INET_DIAG_DCTCPINFO;
+		return sizeof(info->dctcp);
+	}
+	return 0;
+}
+
+static struct tcp_congestion_ops mptcp_dctcp __read_mostly = {
+	.init		= mpdctcp_init,
+	.in_ack_event	= mpdctcp_update_alpha,
+	.cwnd_event	= mpdctcp_cwnd_event,
+	.ssthresh	= mpdctcp_ssthresh,
+	.cong_avoid	= mpdctcp_cong_avoid,
+	.undo_cwnd	= mpdctcp_cwnd_undo,
+	.set_state	= mpdctcp_set_state,
+	.pkts_acked	= mptcp_sbd_pkts_acked,
+	.get_info	= mpdctcp_get_info,
+	.flags		= TCP_CONG_NEEDS_ECN,
+	.owner		= THIS_MODULE,
+	.name		= "mpdctcp",
+};
+
+static int __init mptcp_dctcp_register(void)
+{
+	BUILD_BUG_ON(sizeof(struct mpdctcp) > ICSK_CA_PRIV_SIZE);
+	return tcp_register_congestion_control(&mptcp_dctcp);
+}
+
+static void __exit mptcp_dctcp_unregister(void)
+{
+	tcp_unregister_congestion_control(&mptcp_dctcp);
+}
+
+module_init(mptcp_dctcp_register);
+module_exit(mptcp_dctcp_unregister);
+
+MODULE_LICENSE("GPL");
+MODULE_DESCRIPTION("MPTCP COUPLED DATACENTER TCP (DCTCP)");
+MODULE_VERSION("0.1");
@@ -85,7 +85,7 @@ static struct sock *ecf_get_available_subflow(struct sock *meta_sk,
 		/* We do not send data on this subflow unless it is
 		 * fully established, i.e. the 4th ack has been received.
 		 */
-		if (besttp->mptcp->pre_established)
+		if (mptcp_sub_wait_fourth_ack(besttp))
 			continue;
 
 		sub_sndbuf += bestsk->sk_wmem_queued;
@@ -1,8 +1,11 @@
 #include <linux/module.h>
 #include <linux/proc_fs.h>
 
+#include <net/fib_notifier.h>
 #include <net/mptcp.h>
 #include <net/mptcp_v4.h>
+#include <net/neighbour.h>
+#include <net/netevent.h>
 
 #if IS_ENABLED(CONFIG_IPV6)
 #include <net/mptcp_v6.h>
@@ -16,6 +19,15 @@ enum {
 };
 
 #define MPTCP_SUBFLOW_RETRY_DELAY	1000
+/* Number of retries (with exponential backoff) before giving up on a pair */
+#define MPTCP_SUBFLOW_RETRY_MAX		6
+/* Coalesces the route/neighbour/netdev events that trigger a retry */
+#define MPTCP_SUBFLOW_RETRY_EVENT_DELAY	10
+
+enum {
+	MPTCP_FM_RETRY_PENDING,	/* Some sessions wait for a route */
+	MPTCP_FM_RETRY_EVENT,	/* An event may have made them reachable */
+};
 
 /* Max number of local or remote addresses we can store.
  * When changing, see the bitfield below in fullmesh_rem4/6.
@@ -61,8 +73,11 @@ struct mptcp_addr_event {
 struct fullmesh_priv {
 	/* Worker struct for subflow establishment */
 	struct work_struct subflow_work;
-	/* Delayed worker, when the routing-tables are not yet ready. */
-	struct delayed_work subflow_retry_work;
+
+	/* When the routing-tables are not yet ready - see retry_worker */
+	unsigned long retry_at;
+	u32 retry_pass;
+	u8 retry_backoff;
 
 	/* Remote addresses */
 	struct fullmesh_rem4 remaddr4[MPTCP_MAX_ADDR];
@@ -81,6 +96,10 @@ struct fullmesh_priv {
 
 	/* Have we established the additional subflows for primary pair? */
 	u8 first_pair:1;
+	/* Subflows have been created before the master was fully established */
+	u8 early_join:1;
+	/* One of these early subflows was refused by the peer */
+	u8 early_join_failed:1;
 };
 
 struct mptcp_fm_ns {
@@ -89,6 +108,13 @@ struct mptcp_fm_ns {
 	struct list_head events;
 	struct delayed_work address_worker;
 
+	/* Retries the subflows that could not be created for lack of a route,
+	 * in one pass over all the sessions.
+	 */
+	struct delayed_work retry_worker;
+	unsigned long retry_flags;
+	u32 retry_pass;
+
 	struct net *net;
 };
 
@@ -100,6 +126,10 @@ static int create_on_err __read_mostly;
 module_param(create_on_err, int, 0644);
 MODULE_PARM_DESC(create_on_err, "recreate the subflow upon a timeout");
 
+static int early_join __read_mostly;
+module_param(early_join, int, 0644);
+MODULE_PARM_DESC(early_join, "with MPTCPv1, create the subflows right after the third ack instead of waiting for the connection to be fully established");
+
 static struct mptcp_pm_ops full_mesh __read_mostly;
 
 static void full_mesh_create_subflows(struct sock *meta_sk);
@@ -114,6 +144,56 @@ static struct fullmesh_priv *fullmesh_get_priv(const struct mptcp_cb *mpcb)
 	return (struct fullmesh_priv *)&mpcb->mptcp_pm[0];
 }
 
+/* Does not postpone an earlier pass */
+static void full_mesh_retry_schedule(struct mptcp_fm_ns *fm_ns,
+				     unsigned long delay)
+{
+	struct delayed_work *dwork = &fm_ns->retry_worker;
+
+	if (timer_pending(&dwork->timer) &&
+	    time_before_eq(dwork->timer.expires, jiffies + delay))
+		return;
+
+	mod_delayed_work(mptcp_wq, dwork, delay);
+}
+
+/* A route, neighbour or interface showed up in this namespace */
+static void full_mesh_retry_event(struct net *net)
+{
+	struct mptcp_fm_ns *fm_ns;
+
+	/* The namespace is going away - fm_ns may already be gone */
+	if (!check_net(net))
+		return;
+
+	fm_ns = fm_get_ns(net);
+	if (!fm_ns || !test_bit(MPTCP_FM_RETRY_PENDING, &fm_ns->retry_flags))
+		return;
+
+	if (!test_and_set_bit(MPTCP_FM_RETRY_EVENT, &fm_ns->retry_flags))
+		full_mesh_retry_schedule(fm_ns,
+					 msecs_to_jiffies(MPTCP_SUBFLOW_RETRY_EVENT_DELAY));
+}
+
+/* Usually, we wait for the master to be fully established before creating
+ * new subflows. With MPTCPv1 the third ack carries both keys, so that the
+ * peer knows our token as soon as it got it. If early_join is set we thus
+ * do not wait for the first DATA_ACK, unless an early MP_JOIN was refused
+ * because it overtook the third ack.
+ */
+static bool full_mesh_can_join(const struct mptcp_cb *mpcb)
+{
+	const struct fullmesh_priv *fmp = fullmesh_get_priv(mpcb);
+
+	if (!mpcb->master_sk ||
+	    tcp_sk(mpcb->master_sk)->mptcp->fully_established)
+		return true;
+
+	return early_join && mpcb->mptcp_ver >= MPTCP_VERSION_1 &&
+	       mpcb->master_sk->sk_state == TCP_ESTABLISHED &&
+	       !fmp->early_join_failed;
+}
+
 /* Find the first free index in the bitfield */
 static int __mptcp_find_free_index(u8 bitfield, u8 base)
 {
@@ -322,14 +402,42 @@ static void mptcp_set_init_addr_bit(struct mptcp_cb *mpcb,
 		mptcp_v6_set_init_addr_bit(mpcb, &addr->in6, id);
 }
 
+/* A path on which the last subflows saw heavy loss only gets backup subflows */
+static int full_mesh_init4_subsockets(struct sock *meta_sk,
+				      const struct mptcp_loc4 *loc,
+				      struct mptcp_rem4 *rem)
+{
+	struct mptcp_loc4 loc4 = *loc;
+
+	if (mptcp_metrics_path_bad4(meta_sk, loc, rem))
+		loc4.low_prio = 1;
+
+	return mptcp_init4_subsockets(meta_sk, &loc4, rem);
+}
+
+#if IS_ENABLED(CONFIG_IPV6)
+static int full_mesh_init6_subsockets(struct sock *meta_sk,
+				      const struct mptcp_loc6 *loc,
+				      struct mptcp_rem6 *rem)
+{
+	struct mptcp_loc6 loc6 = *loc;
+
+	if (mptcp_metrics_path_bad6(meta_sk, loc, rem))
+		loc6.low_prio = 1;
+
+	return mptcp_init6_subsockets(meta_sk, &loc6, rem);
+}
+#endif
+
 static void mptcp_v4_subflows(struct sock *meta_sk,
 			      const struct mptcp_loc4 *loc,
 			      struct mptcp_rem4 *rem)
 {
-	int i;
+	int i, n = mptcp_policy_num_subflows(tcp_sk(meta_sk)->mpcb,
+					     num_subflows);
 
-	for (i = 1; i < num_subflows; i++)
-		mptcp_init4_subsockets(meta_sk, loc, rem);
+	for (i = 1; i < n; i++)
+		full_mesh_init4_subsockets(meta_sk, loc, rem);
 }
 
 #if IS_ENABLED(CONFIG_IPV6)
@@ -337,25 +445,41 @@ static void mptcp_v6_subflows(struct sock *meta_sk,
 			      const struct mptcp_loc6 *loc,
 			      struct mptcp_rem6 *rem)
 {
-	int i;
+	int i, n = mptcp_policy_num_subflows(tcp_sk(meta_sk)->mpcb,
+					     num_subflows);
 
-	for (i = 1; i < num_subflows; i++)
-		mptcp_init6_subsockets(meta_sk, loc, rem);
+	for (i = 1; i < n; i++)
+		full_mesh_init6_subsockets(meta_sk, loc, rem);
 }
 #endif
 
-static void retry_subflow_worker(struct work_struct *work)
+/* Called with the meta-lock held, when some address-pairs had no route */
+static void full_mesh_retry_later(struct mptcp_cb *mpcb)
 {
-	struct delayed_work *delayed_work = container_of(work,
-							 struct delayed_work,
-							 work);
-	struct fullmesh_priv *fmp = container_of(delayed_work,
-						 struct fullmesh_priv,
-						 subflow_retry_work);
-	struct mptcp_cb *mpcb = fmp->mpcb;
-	struct sock *meta_sk = mpcb->meta_sk;
-	struct mptcp_loc_addr *mptcp_local;
+	struct fullmesh_priv *fmp = fullmesh_get_priv(mpcb);
+	struct mptcp_fm_ns *fm_ns = fm_get_ns(sock_net(mpcb->meta_sk));
+	unsigned long delay;
+
+	delay = msecs_to_jiffies(MPTCP_SUBFLOW_RETRY_DELAY) << fmp->retry_backoff;
+	fmp->retry_backoff++;
+	fmp->retry_at = jiffies + delay;
+
+	set_bit(MPTCP_FM_RETRY_PENDING, &fm_ns->retry_flags);
+	full_mesh_retry_schedule(fm_ns, delay);
+}
+
+/* Retries the address-pairs in retry_bitfield. Those that still have no
+ * route are retried later with an exponential backoff, unless a route,
+ * neighbour or netdev event comes first.
+ */
+static void full_mesh_retry_subflows(struct sock *meta_sk)
+{
+	struct mptcp_cb *mpcb = tcp_sk(meta_sk)->mpcb;
+	struct fullmesh_priv *fmp = fullmesh_get_priv(mpcb);
 	struct mptcp_fm_ns *fm_ns = fm_get_ns(sock_net(meta_sk));
+	u8 again4[MPTCP_MAX_ADDR] = { 0 }, again6[MPTCP_MAX_ADDR] = { 0 };
+	struct mptcp_loc_addr *mptcp_local;
+	bool again = false, give_up = false;
 	int iter = 0, i;
 
 	/* We need a local (stable) copy of the address-list. Really, it is not
@@ -384,27 +508,33 @@ static void retry_subflow_worker(struct work_struct *work)
 
 	iter++;
 
-	if (sock_flag(meta_sk, SOCK_DEAD))
-		goto exit;
+	if (sock_flag(meta_sk, SOCK_DEAD) || !mptcp_can_new_subflow(meta_sk)) {
+		give_up = true;
+		goto put_back;
+	}
 
 	mptcp_for_each_bit_set(fmp->rem4_bits, i) {
 		struct fullmesh_rem4 *rem = &fmp->remaddr4[i];
 		/* Do we need to retry establishing a subflow ? */
 		if (rem->retry_bitfield) {
-			int i = mptcp_find_free_index(~rem->retry_bitfield);
+			int j = mptcp_find_free_index(~rem->retry_bitfield);
 			struct mptcp_rem4 rem4;
 
-			rem->bitfield |= (1 << i);
-			rem->retry_bitfield &= ~(1 << i);
+			rem->bitfield |= (1 << j);
+			rem->retry_bitfield &= ~(1 << j);
 
 			rem4.addr = rem->addr;
 			rem4.port = rem->port;
 			rem4.rem4_id = rem->rem4_id;
 
-			mptcp_init4_subsockets(meta_sk, &mptcp_local->locaddr4[i], &rem4);
-			mptcp_v4_subflows(meta_sk,
-					  &mptcp_local->locaddr4[i],
-					  &rem4);
+			if (full_mesh_init4_subsockets(meta_sk, &mptcp_local->locaddr4[j],
+						       &rem4) == -ENETUNREACH) {
+				again4[i] |= (1 << j);
+			} else {
+				mptcp_v4_subflows(meta_sk,
+						  &mptcp_local->locaddr4[j],
+						  &rem4);
+			}
 			goto next_subflow;
 		}
 	}
@@ -415,31 +545,173 @@ static void retry_subflow_worker(struct work_struct *work)
 
 		/* Do we need to retry establishing a subflow ? */
 		if (rem->retry_bitfield) {
-			int i = mptcp_find_free_index(~rem->retry_bitfield);
+			int j = mptcp_find_free_index(~rem->retry_bitfield);
 			struct mptcp_rem6 rem6;
 
-			rem->bitfield |= (1 << i);
-			rem->retry_bitfield &= ~(1 << i);
+			rem->bitfield |= (1 << j);
+			rem->retry_bitfield &= ~(1 << j);
 
 			rem6.addr = rem->addr;
 			rem6.port = rem->port;
 			rem6.rem6_id = rem->rem6_id;
 
-			mptcp_init6_subsockets(meta_sk, &mptcp_local->locaddr6[i], &rem6);
-			mptcp_v6_subflows(meta_sk,
-					  &mptcp_local->locaddr6[i],
-					  &rem6);
+			if (full_mesh_init6_subsockets(meta_sk, &mptcp_local->locaddr6[j],
+						       &rem6) == -ENETUNREACH) {
+				again6[i] |= (1 << j);
+			} else {
+				mptcp_v6_subflows(meta_sk,
+						  &mptcp_local->locaddr6[j],
+						  &rem6);
+			}
 			goto next_subflow;
 		}
 	}
 #endif
 
+	if (fmp->retry_backoff >= MPTCP_SUBFLOW_RETRY_MAX)
+		give_up = true;
+
+put_back:
+	/* Put back what is still unreachable, until we give up on it. While a
+	 * pair waits in retry_bitfield, it keeps its bit in bitfield, so that
+	 * create_subflow_worker doesn't open it in the meantime.
+	 */
+	for (i = 0; i < MPTCP_MAX_ADDR; i++) {
+		if ((fmp->rem4_bits & (1 << i)) && again4[i]) {
+			if (give_up) {
+				fmp->remaddr4[i].bitfield &= ~again4[i];
+			} else {
+				fmp->remaddr4[i].retry_bitfield |= again4[i];
+				again = true;
+			}
+		}
+		if ((fmp->rem6_bits & (1 << i)) && again6[i]) {
+			if (give_up) {
+				fmp->remaddr6[i].bitfield &= ~again6[i];
+			} else {
+				fmp->remaddr6[i].retry_bitfield |= again6[i];
+				again = true;
+			}
+		}
+	}
+
+	if (again)
+		full_mesh_retry_later(mpcb);
+	else
+		fmp->retry_backoff = 0;
+
 exit:
 	kfree(mptcp_local);
 	release_sock(meta_sk);
 	mutex_unlock(&mpcb->mpcb_mutex);
-	mptcp_mpcb_put(mpcb);
-	sock_put(meta_sk);
+}
+
+static bool full_mesh_retry_pending(const struct fullmesh_priv *fmp)
+{
+	int i;
+
+	mptcp_for_each_bit_set(fmp->rem4_bits, i) {
+		if (fmp->remaddr4[i].retry_bitfield)
+			return true;
+	}
+	mptcp_for_each_bit_set(fmp->rem6_bits, i) {
+		if (fmp->remaddr6[i].retry_bitfield)
+			return true;
+	}
+
+	return false;
+}
+
+/* A single pass over all the MPTCP-sessions of the namespace, retrying
+ * those that are due (or all of them, upon an event).
+ */
+static void full_mesh_retry_worker(struct work_struct *work)
+{
+	const struct delayed_work *delayed_work = container_of(work,
+							 struct delayed_work,
+							 work);
+	struct mptcp_fm_ns *fm_ns = container_of(delayed_work,
+						 struct mptcp_fm_ns,
+						 retry_worker);
+	struct net *net = fm_ns->net;
+	unsigned long now = jiffies, next = 0;
+	bool event, pending = false;
+	u32 pass;
+	int i;
+
+	event = test_and_clear_bit(MPTCP_FM_RETRY_EVENT, &fm_ns->retry_flags);
+	clear_bit(MPTCP_FM_RETRY_PENDING, &fm_ns->retry_flags);
+	pass = ++fm_ns->retry_pass;
+
+	for (i = 0; i <= mptcp_tk_htable.mask; i++) {
+		const struct hlist_nulls_node *node;
+		struct sock *meta_sk;
+		struct tcp_sock *meta_tp;
+		struct mptcp_cb *mpcb;
+
+next_in_bucket:
+		meta_sk = NULL;
+		mpcb = NULL;
+
+		rcu_read_lock_bh();
+		hlist_nulls_for_each_entry_rcu(meta_tp, node,
+					       &mptcp_tk_htable.hashtable[i],
+					       tk_table) {
+			struct sock *sk = (struct sock *)meta_tp;
+			struct fullmesh_priv *fmp;
+
+			if (sock_net(sk) != net)
+				continue;
+
+			if (unlikely(!refcount_inc_not_zero(&sk->sk_refcnt)))
+				continue;
+
+			bh_lock_sock(sk);
+
+			mpcb = meta_tp->mpcb;
+			if (!mpcb || !mptcp(meta_tp) || !is_meta_sk(sk) ||
+			    mpcb->pm_ops != &full_mesh)
+				goto next;
+
+			fmp = fullmesh_get_priv(mpcb);
+			if (fmp->retry_pass == pass || !full_mesh_retry_pending(fmp))
+				goto next;
+
+			if (!event && time_before(now, fmp->retry_at)) {
+				if (!pending || time_before(fmp->retry_at, next))
+					next = fmp->retry_at;
+				pending = true;
+				goto next;
+			}
+
+			fmp->retry_pass = pass;
+			refcount_inc(&mpcb->mpcb_refcnt);
+			bh_unlock_sock(sk);
+			meta_sk = sk;
+			break;
+next:
+			bh_unlock_sock(sk);
+			sock_put(sk);
+		}
+		rcu_read_unlock_bh();
+
+		if (!meta_sk)
+			continue;
+
+		full_mesh_retry_subflows(meta_sk);
+
+		mptcp_mpcb_put(mpcb);
+		sock_put(meta_sk);
+
+		cond_resched();
+		goto next_in_bucket;
+	}
+
+	if (pending) {
+		set_bit(MPTCP_FM_RETRY_PENDING, &fm_ns->retry_flags);
+		full_mesh_retry_schedule(fm_ns, time_after(next, now) ?
+					 next - now : 0);
+	}
 }
 
 /**
@@ -484,10 +756,13 @@ static void create_subflow_worker(struct work_struct *work)
 	if (sock_flag(meta_sk, SOCK_DEAD) || !mptcp(tcp_sk(meta_sk)))
 		goto exit;
 
-	if (mpcb->master_sk &&
-	    !tcp_sk(mpcb->master_sk)->mptcp->fully_established)
+	if (!full_mesh_can_join(mpcb))
 		goto exit;
 
+	/* Subflows that fail from now on are not retried as early joins */
+	fmp->early_join = mpcb->master_sk &&
+			  !tcp_sk(mpcb->master_sk)->mptcp->fully_established;
+
 	/* Create the additional subflows for the first pair */
 	if (fmp->first_pair == 0 && mpcb->master_sk) {
 		struct mptcp_loc4 loc;
@@ -527,8 +802,8 @@ static void create_subflow_worker(struct work_struct *work)
 			rem4.rem4_id = rem->rem4_id;
 
 			/* If a route is not yet available then retry once */
-			if (mptcp_init4_subsockets(meta_sk, &mptcp_local->locaddr4[i],
-						   &rem4) == -ENETUNREACH)
+			if (full_mesh_init4_subsockets(meta_sk, &mptcp_local->locaddr4[i],
+						       &rem4) == -ENETUNREACH)
 				retry = rem->retry_bitfield |= (1 << i);
 			else
 				mptcp_v4_subflows(meta_sk,
@@ -575,8 +850,8 @@ static void create_subflow_worker(struct work_struct *work)
 			rem6.rem6_id = rem->rem6_id;
 
 			/* If a route is not yet available then retry once */
-			if (mptcp_init6_subsockets(meta_sk, &mptcp_local->locaddr6[i],
-						   &rem6) == -ENETUNREACH)
+			if (full_mesh_init6_subsockets(meta_sk, &mptcp_local->locaddr6[i],
+						       &rem6) == -ENETUNREACH)
 				retry = rem->retry_bitfield |= (1 << i);
 			else
 				mptcp_v6_subflows(meta_sk,
@@ -587,12 +862,8 @@ static void create_subflow_worker(struct work_struct *work)
 	}
 #endif
 
-	if (retry && !delayed_work_pending(&fmp->subflow_retry_work)) {
-		sock_hold(meta_sk);
-		refcount_inc(&mpcb->mpcb_refcnt);
-		queue_delayed_work(mptcp_wq, &fmp->subflow_retry_work,
-				   msecs_to_jiffies(MPTCP_SUBFLOW_RETRY_DELAY));
-	}
+	if (retry)
+		full_mesh_retry_later(mpcb);
 
 exit:
 	kfree(mptcp_local);
@@ -984,6 +1255,8 @@ static void mptcp_address_worker(struct work_struct *work)
 						if (event->low_prio != tp->mptcp->low_prio) {
 							tp->mptcp->send_mp_prio = 1;
 							tp->mptcp->low_prio = event->low_prio;
+							tcp_call_bpf_2arg(sk, BPF_SOCK_OPS_MPTCP_PRIO_CB,
+									  tp->mptcp->low_prio, 0);
 
 							tcp_send_ack(sk);
 						}
@@ -995,6 +1268,8 @@ static void mptcp_address_worker(struct work_struct *work)
 						if (event->low_prio != tp->mptcp->low_prio) {
 							tp->mptcp->send_mp_prio = 1;
 							tp->mptcp->low_prio = event->low_prio;
+							tcp_call_bpf_2arg(sk, BPF_SOCK_OPS_MPTCP_PRIO_CB,
+									  tp->mptcp->low_prio, 0);
 
 							tcp_send_ack(sk);
 						}
@@ -1225,6 +1500,10 @@ static int netdev_event(struct notifier_block *this, unsigned long event,
 #endif
 
 	rcu_read_unlock();
+
+	if (event != NETDEV_DOWN)
+		full_mesh_retry_event(dev_net(dev));
+
 	return NOTIFY_DONE;
 }
 
@@ -1232,6 +1511,42 @@ static struct notifier_block mptcp_pm_netdev_notifier = {
 		.notifier_call = netdev_event,
 };
 
+/* New routes may make the pairs in retry_bitfield reachable */
+static int fib_event(struct notifier_block *this, unsigned long event,
+		     void *ptr)
+{
+	const struct fib_notifier_info *info = ptr;
+
+	if (info->family != AF_INET && info->family != AF_INET6)
+		return NOTIFY_DONE;
+
+	if (event == FIB_EVENT_ENTRY_ADD || event == FIB_EVENT_ENTRY_REPLACE ||
+	    event == FIB_EVENT_ENTRY_APPEND)
+		full_mesh_retry_event(info->net);
+
+	return NOTIFY_DONE;
+}
+
+static struct notifier_block mptcp_pm_fib_notifier = {
+		.notifier_call = fib_event,
+};
+
+/* As does a gateway becoming reachable */
+static int netevent_event(struct notifier_block *this, unsigned long event,
+			  void *ptr)
+{
+	const struct neighbour *n = ptr;
+
+	if (event == NETEVENT_NEIGH_UPDATE && (n->nud_state & NUD_VALID))
+		full_mesh_retry_event(dev_net(n->dev));
+
+	return NOTIFY_DONE;
+}
+
+static struct notifier_block mptcp_pm_netevent_notifier = {
+		.notifier_call = netevent_event,
+};
+
 static void full_mesh_add_raddr(struct mptcp_cb *mpcb,
 				const union inet_addr *addr,
 				sa_family_t family, __be16 port, u8 id)
@@ -1293,7 +1608,6 @@ static void full_mesh_new_session(const struct sock *meta_sk)
 
 	/* Initialize workqueue-struct */
 	INIT_WORK(&fmp->subflow_work, create_subflow_worker);
-	INIT_DELAYED_WORK(&fmp->subflow_retry_work, retry_subflow_worker);
 	fmp->mpcb = mpcb;
 
 	if (!meta_v4 && meta_sk->sk_ipv6only)
@@ -1348,6 +1662,10 @@ static void full_mesh_new_session(const struct sock *meta_sk)
 	if (master_tp->mptcp->send_mp_prio)
 		tcp_send_ack(mpcb->master_sk);
 
+	/* The third ack has been sent - no need to wait for more */
+	if (early_join)
+		full_mesh_create_subflows(mpcb->meta_sk);
+
 	return;
 
 fallback:
@@ -1365,14 +1683,14 @@ static void full_mesh_create_subflows(struct sock *meta_sk)
 	    mpcb->server_side || sock_flag(meta_sk, SOCK_DEAD))
 		return;
 
-	if (mpcb->master_sk &&
-	    !tcp_sk(mpcb->master_sk)->mptcp->fully_established)
+	if (!full_mesh_can_join(mpcb))
 		return;
 
 	if (!work_pending(&fmp->subflow_work)) {
 		sock_hold(meta_sk);
 		refcount_inc(&mpcb->mpcb_refcnt);
-		queue_work(mptcp_wq, &fmp->subflow_work);
+		queue_work_on(mptcp_work_cpu(mpcb, NULL), mptcp_conn_wq,
+			      &fmp->subflow_work);
 	}
 }
 
@@ -1417,6 +1735,8 @@ static void full_mesh_release_sock(struct sock *meta_sk)
 			if (mptcp_local->locaddr4[i].low_prio != tp->mptcp->low_prio) {
 				tp->mptcp->send_mp_prio = 1;
 				tp->mptcp->low_prio = mptcp_local->locaddr4[i].low_prio;
+				tcp_call_bpf_2arg(sk, BPF_SOCK_OPS_MPTCP_PRIO_CB,
+						  tp->mptcp->low_prio, 0);
 
 				tcp_send_ack(sk);
 			}
@@ -1461,6 +1781,8 @@ static void full_mesh_release_sock(struct sock *meta_sk)
 			if (mptcp_local->locaddr6[i].low_prio != tp->mptcp->low_prio) {
 				tp->mptcp->send_mp_prio = 1;
 				tp->mptcp->low_prio = mptcp_local->locaddr6[i].low_prio;
+				tcp_call_bpf_2arg(sk, BPF_SOCK_OPS_MPTCP_PRIO_CB,
+						  tp->mptcp->low_prio, 0);
 
 				tcp_send_ack(sk);
 			}
@@ -1689,9 +2011,17 @@ static void full_mesh_delete_subflow(struct sock *sk)
 	struct mptcp_fm_ns *fm_ns = fm_get_ns(sock_net(sk));
 	struct sock *meta_sk = mptcp_meta_sk(sk);
 	struct mptcp_loc_addr *mptcp_local;
+	bool early_err;
 	int index, i;
 
-	if (!create_on_err)
+	/* An early MP_JOIN got refused (no RTT-sample, thus no SYN/ACK). Most
+	 * likely, it overtook the third ack. Retry it the regular way.
+	 */
+	early_err = fmp->early_join && !tcp_sk(sk)->srtt_us;
+	if (early_err)
+		fmp->early_join_failed = 1;
+
+	if (!create_on_err && !early_err)
 		return;
 
 	if (!mptcp_can_new_subflow(meta_sk))
@@ -1748,7 +2078,8 @@ static void full_mesh_delete_subflow(struct sock *sk)
 	rcu_read_unlock_bh();
 
 	/* re-schedule the creation of failed subflows */
-	if (tcp_sk(sk)->mptcp->sk_err == ETIMEDOUT || sk->sk_err == ETIMEDOUT)
+	if (early_err || tcp_sk(sk)->mptcp->sk_err == ETIMEDOUT ||
+	    sk->sk_err == ETIMEDOUT)
 		full_mesh_create_subflows(meta_sk);
 }
 
@@ -1813,6 +2144,7 @@ static int mptcp_fm_init_net(struct net *net)
 
 	rcu_assign_pointer(fm_ns->local, mptcp_local);
 	INIT_DELAYED_WORK(&fm_ns->address_worker, mptcp_address_worker);
+	INIT_DELAYED_WORK(&fm_ns->retry_worker, full_mesh_retry_worker);
 	INIT_LIST_HEAD(&fm_ns->events);
 	spin_lock_init(&fm_ns->local_lock);
 	fm_ns->net = net;
@@ -1834,6 +2166,7 @@ static void mptcp_fm_exit_net(struct net *net)
 
 	fm_ns = fm_get_ns(net);
 	cancel_delayed_work_sync(&fm_ns->address_worker);
+	cancel_delayed_work_sync(&fm_ns->retry_worker);
 
 	rcu_read_lock_bh();
 
@@ -1890,6 +2223,12 @@ static int __init full_mesh_register(void)
 	ret = register_netdevice_notifier(&mptcp_pm_netdev_notifier);
 	if (ret)
 		goto err_reg_netdev;
+	ret = register_fib_notifier(&mptcp_pm_fib_notifier, NULL);
+	if (ret)
+		goto err_reg_fib;
+	ret = register_netevent_notifier(&mptcp_pm_netevent_notifier);
+	if (ret)
+		goto err_reg_netevent;
 
 #if IS_ENABLED(CONFIG_IPV6)
 	ret = register_inet6addr_notifier(&inet6_addr_notifier);
@@ -1910,6 +2249,10 @@ static int __init full_mesh_register(void)
 	unregister_inet6addr_notifier(&inet6_addr_notifier);
 err_reg_inet6addr:
 #endif
+	unregister_netevent_notifier(&mptcp_pm_netevent_notifier);
+err_reg_netevent:
+	unregister_fib_notifier(&mptcp_pm_fib_notifier);
+err_reg_fib:
 	unregister_netdevice_notifier(&mptcp_pm_netdev_notifier);
 err_reg_netdev:
 	unregister_inetaddr_notifier(&mptcp_pm_inetaddr_notifier);
@@ -1923,6 +2266,8 @@ static void full_mesh_unregister(void)
 #if IS_ENABLED(CONFIG_IPV6)
 	unregister_inet6addr_notifier(&inet6_addr_notifier);
 #endif
+	unregister_netevent_notifier(&mptcp_pm_netevent_notifier);
+	unregister_fib_notifier(&mptcp_pm_fib_notifier);
 	unregister_netdevice_notifier(&mptcp_pm_netdev_notifier);
 	unregister_inetaddr_notifier(&mptcp_pm_inetaddr_notifier);
 	unregister_pernet_subsys(&full_mesh_net_ops);
@@ -48,6 +48,8 @@ static inline void mptcp_become_fully_estab(struct sock *sk)
 {
 	tcp_sk(sk)->mptcp->fully_established = 1;
 
+	tcp_call_bpf(sk, BPF_SOCK_OPS_MPTCP_SUB_ESTABLISHED_CB, 0, NULL);
+
 	if (is_master_tp(tcp_sk(sk)) &&
 	    tcp_sk(sk)->mpcb->pm_ops->fully_established)
 		tcp_sk(sk)->mpcb->pm_ops->fully_established(mptcp_meta_sk(sk));
@@ -2261,6 +2263,8 @@ bool mptcp_handle_options(struct sock *sk, const struct tcphdr *th,
 	if (mopt->saw_low_prio) {
 		if (mopt->saw_low_prio == 1) {
 			tp->mptcp->rcv_low_prio = mopt->low_prio;
+			tcp_call_bpf_2arg(sk, BPF_SOCK_OPS_MPTCP_PRIO_CB,
+					  mopt->low_prio, 1);
 			if (mpcb->pm_ops->prio_changed)
 				mpcb->pm_ops->prio_changed(sk, mopt->low_prio);
 		} else {
@@ -2269,6 +2273,9 @@ bool mptcp_handle_options(struct sock *sk, const struct tcphdr *th,
 			mptcp_for_each_sub(tp->mpcb, mptcp) {
 				if (mptcp->rem_id == mopt->prio_addr_id) {
 					mptcp->rcv_low_prio = mopt->low_prio;
+					tcp_call_bpf_2arg(mptcp_to_sock(mptcp),
+							  BPF_SOCK_OPS_MPTCP_PRIO_CB,
+							  mopt->low_prio, 1);
 					if (mpcb->pm_ops->prio_changed)
 						mpcb->pm_ops->prio_changed(sk,
 									   mopt->low_prio);
@@ -2417,9 +2424,11 @@ int mptcp_rcv_synsent_state_process(struct sock *sk, struct sock **skptr,
 		}
 
 		/* Set this flag in order to postpone data sending
-		 * until the 4th ack arrives.
+		 * until the 4th ack arrives - or, with early data, to keep
+		 * on retransmitting the 3rd ack until then.
 		 */
 		tp->mptcp->pre_established = 1;
+		tp->mptcp->join_early = !!sysctl_mptcp_join_early_data;
 		tp->mptcp->rcv_low_prio = tp->mptcp->rx_opt.low_prio;
 
 		mptcp_hmac(mpcb->mptcp_ver, (u8 *)&mpcb->mptcp_loc_key,
@@ -2467,6 +2476,7 @@ int mptcp_rcv_synsent_state_process(struct sock *sk, struct sock **skptr,
 		 */
 		tp->mptcp->snt_isn = tp->snd_una - 1;
 		tp->mpcb->dss_csum = mopt->dss_csum;
+		mptcp_init_dss_tmpl(tp);
 		if (tp->mpcb->dss_csum)
 			MPTCP_INC_STATS(sock_net(sk), MPTCP_MIB_CSUMENABLED);
 
@@ -45,7 +45,7 @@ u32 mptcp_v4_get_nonce(__be32 saddr, __be32 daddr, __be16 sport, __be16 dport)
 {
 	return siphash_4u32((__force u32)saddr, (__force u32)daddr,
 			    (__force u32)sport << 16 | (__force u32)dport,
-			    mptcp_seed++, &mptcp_secret);
+			    mptcp_next_seed(), &mptcp_secret);
 }
 
 u64 mptcp_v4_get_key(__be32 saddr, __be32 daddr, __be16 sport, __be16 dport,
@@ -269,6 +269,9 @@ int __mptcp_init4_subsockets(struct sock *meta_sk, const struct mptcp_loc4 *loc,
 	struct socket *sock = (struct socket *)&sock_full;
 	int ret;
 
+	if (!mptcp_policy_if_allowed(tcp_sk(meta_sk)->mpcb, loc->if_idx))
+		return -EPERM;
+
 	/** First, create and prepare the new socket */
 	memcpy(&sock_full, meta_sk->sk_socket, sizeof(sock_full));
 	sock->state = SS_UNCONNECTED;
@@ -296,7 +299,8 @@ int __mptcp_init4_subsockets(struct sock *meta_sk, const struct mptcp_loc4 *loc,
 	}
 
 	tp->mptcp->slave_sk = 1;
-	tp->mptcp->low_prio = loc->low_prio;
+	tp->mptcp->low_prio = loc->low_prio ||
+			      mptcp_policy_if_backup(tp->mpcb, loc->if_idx);
 
 	/* Initializing the timer for an MPTCP subflow */
 	timer_setup(&tp->mptcp->mptcp_ack_timer, mptcp_ack_handler, 0);
@@ -333,6 +337,9 @@ int __mptcp_init4_subsockets(struct sock *meta_sk, const struct mptcp_loc4 *loc,
 	if (tcp_sk(meta_sk)->mpcb->pm_ops->init_subsocket_v4)
 		tcp_sk(meta_sk)->mpcb->pm_ops->init_subsocket_v4(sk, rem->addr);
 
+	/* Let sock_ops programs tune the subflow before its SYN is sent */
+	tcp_call_bpf(sk, BPF_SOCK_OPS_MPTCP_SUB_CREATED_CB, 0, NULL);
+
 	ret = kernel_connect(sock, (struct sockaddr *)&rem_in,
 			     sizeof(struct sockaddr_in), O_NONBLOCK);
 	if (ret < 0 && ret != -EINPROGRESS) {
@@ -41,6 +41,7 @@
 #include <net/ip6_route.h>
 #include <net/mptcp.h>
 #include <net/mptcp_v6.h>
+#include <net/seg6.h>
 #include <net/tcp.h>
 #include <net/transp_v6.h>
 
@@ -56,7 +57,7 @@ __u32 mptcp_v6_get_nonce(const __be32 *saddr, const __be32 *daddr,
 	} __aligned(SIPHASH_ALIGNMENT) combined = {
 		.saddr = *(struct in6_addr *)saddr,
 		.daddr = *(struct in6_addr *)daddr,
-		.seed = mptcp_seed++,
+		.seed = mptcp_next_seed(),
 		.sport = sport,
 		.dport = dport
 	};
@@ -297,6 +298,9 @@ int __mptcp_init6_subsockets(struct sock *meta_sk, const struct mptcp_loc6 *loc,
 	struct socket *sock = (struct socket *)&sock_full;
 	int ret;
 
+	if (!mptcp_policy_if_allowed(tcp_sk(meta_sk)->mpcb, loc->if_idx))
+		return -EPERM;
+
 	/** First, create and prepare the new socket */
 	memcpy(&sock_full, meta_sk->sk_socket, sizeof(sock_full));
 	sock->state = SS_UNCONNECTED;
@@ -324,7 +328,8 @@ int __mptcp_init6_subsockets(struct sock *meta_sk, const struct mptcp_loc6 *loc,
 	}
 
 	tp->mptcp->slave_sk = 1;
-	tp->mptcp->low_prio = loc->low_prio;
+	tp->mptcp->low_prio = loc->low_prio ||
+			      mptcp_policy_if_backup(tp->mpcb, loc->if_idx);
 
 	/* Initializing the timer for an MPTCP subflow */
 	timer_setup(&tp->mptcp->mptcp_ack_timer, mptcp_ack_handler, 0);
@@ -361,6 +366,9 @@ int __mptcp_init6_subsockets(struct sock *meta_sk, const struct mptcp_loc6 *loc,
 	if (tcp_sk(meta_sk)->mpcb->pm_ops->init_subsocket_v6)
 		tcp_sk(meta_sk)->mpcb->pm_ops->init_subsocket_v6(sk, rem->addr);
 
+	/* Let sock_ops programs tune the subflow before its SYN is sent */
+	tcp_call_bpf(sk, BPF_SOCK_OPS_MPTCP_SUB_CREATED_CB, 0, NULL);
+
 	ret = kernel_connect(sock, (struct sockaddr *)&rem_in,
 			     sizeof(struct sockaddr_in6), O_NONBLOCK);
 	if (ret < 0 && ret != -EINPROGRESS) {
@@ -392,6 +400,33 @@ int __mptcp_init6_subsockets(struct sock *meta_sk, const struct mptcp_loc6 *loc,
 }
 EXPORT_SYMBOL(__mptcp_init6_subsockets);
 
+/* Installs srh as the routing header of a subflow that is not yet connected,
+ * as setsockopt(IPV6_RTHDR) would do.
+ */
+int mptcp_v6_set_srh(struct sock *sk, struct ipv6_sr_hdr *srh)
+{
+	struct ipv6_opt_hdr *hdr = (struct ipv6_opt_hdr *)srh;
+	struct ipv6_txoptions *opt;
+
+	if (!seg6_validate_srh(srh, ipv6_optlen(hdr)))
+		return -EINVAL;
+
+	/* The subflow is not yet visible to anyone else */
+	opt = rcu_dereference_protected(inet6_sk(sk)->opt, 1);
+	opt = ipv6_renew_options(sk, opt, IPV6_RTHDR, hdr);
+	if (IS_ERR(opt))
+		return PTR_ERR(opt);
+
+	opt = ipv6_update_options(sk, opt);
+	if (opt) {
+		atomic_sub(opt->tot_len, &sk->sk_omem_alloc);
+		txopt_put(opt);
+	}
+
+	return 0;
+}
+EXPORT_SYMBOL(mptcp_v6_set_srh);
+
 const struct inet_connection_sock_af_ops mptcp_v6_specific = {
 	.queue_xmit	   = inet6_csk_xmit,
 	.send_check	   = tcp_v6_send_check,
@@ -0,0 +1,380 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ *	MPTCP implementation - Per-path metrics cache
+ *
+ *	tcp_metrics keeps its data per destination, but MPTCP subflows towards
+ *	the same destination may take very different paths. Thus, we remember
+ *	per (local address, remote address, interface) what the last subflows
+ *	on this path experienced: RTT, delivery-rate, loss and cwnd.
+ *
+ *	New subflows get their srtt (and, with mptcp_path_metrics = 2, their
+ *	cwnd) seeded from the cache. The fullmesh and ndiffports path-managers
+ *	open subflows on a path that saw heavy loss as backup, see
+ *	mptcp_metrics_path_bad4/6().
+ *
+ *	This program is free software; you can redistribute it and/or
+ *      modify it under the terms of the GNU General Public License
+ *      as published by the Free Software Foundation; either version
+ *      2 of the License, or (at your option) any later version.
+ */
+
+#include <linux/jhash.h>
+#include <linux/slab.h>
+#include <net/mptcp.h>
+#include <net/tcp.h>
+
+#define MPTCP_METRICS_HASH_BITS		8
+/* Entries older than this are neither used nor reported */
+#define MPTCP_METRICS_TIMEOUT		(60 * 60 * HZ)
+/* Past this depth of a bucket, the oldest entry is recycled */
+#define MPTCP_METRICS_RECLAIM_DEPTH	5
+/* Subflows that sent less than this are not representative of a path */
+#define MPTCP_METRICS_MIN_SEGS		16
+/* Scale of the loss-rate */
+#define MPTCP_METRICS_ONE		1024
+/* More than 1/8 of the segments retransmitted */
+#define MPTCP_METRICS_BAD_LOSS		(MPTCP_METRICS_ONE / 8)
+
+/* 0 = off, 1 = record and seed the srtt, 2 = seed the cwnd as well */
+int sysctl_mptcp_path_metrics __read_mostly = 1;
+
+static struct hlist_head mptcp_metrics_hash[1 << MPTCP_METRICS_HASH_BITS];
+static DEFINE_SPINLOCK(mptcp_metrics_lock);
+
+struct mptcp_metrics_key {
+	union inet_addr	loc;
+	union inet_addr	rem;
+	sa_family_t	family;
+	int		if_idx;
+};
+
+static void mptcp_metrics_key(const struct sock *sk,
+			      struct mptcp_metrics_key *key)
+{
+	memset(key, 0, sizeof(*key));
+	key->if_idx = sk->sk_bound_dev_if;
+
+	if (sk->sk_family == AF_INET || mptcp_v6_is_v4_mapped(sk)) {
+		key->family = AF_INET;
+		key->loc.ip = inet_sk(sk)->inet_saddr;
+		key->rem.ip = inet_sk(sk)->inet_daddr;
+	}
+#if IS_ENABLED(CONFIG_IPV6)
+	else {
+		key->family = AF_INET6;
+		key->loc.in6 = sk->sk_v6_rcv_saddr;
+		key->rem.in6 = sk->sk_v6_daddr;
+	}
+#endif
+}
+
+static struct hlist_head *mptcp_metrics_bucket(const struct net *net,
+					       const struct mptcp_metrics_key *key)
+{
+	u32 hash = jhash2(key->loc.all, 4, net_hash_mix(net));
+
+	hash = jhash2(key->rem.all, 4, hash ^ key->if_idx);
+
+	return &mptcp_metrics_hash[hash_32(hash, MPTCP_METRICS_HASH_BITS)];
+}
+
+static bool mptcp_metrics_match(const struct mptcp_path_metrics *pm,
+				const struct net *net,
+				const struct mptcp_metrics_key *key)
+{
+	return pm->family == key->family && pm->if_idx == key->if_idx &&
+	       !memcmp(&pm->loc, &key->loc, sizeof(pm->loc)) &&
+	       !memcmp(&pm->rem, &key->rem, sizeof(pm->rem)) &&
+	       net_eq(read_pnet(&pm->net), net);
+}
+
+static bool mptcp_metrics_fresh(const struct mptcp_path_metrics *pm)
+{
+	return time_before(jiffies, pm->stamp + MPTCP_METRICS_TIMEOUT);
+}
+
+/* Must be called under rcu_read_lock or with mptcp_metrics_lock held */
+static struct mptcp_path_metrics *
+__mptcp_metrics_find(const struct net *net, const struct mptcp_metrics_key *key)
+{
+	struct mptcp_path_metrics *pm;
+
+	hlist_for_each_entry_rcu(pm, mptcp_metrics_bucket(net, key), node) {
+		if (mptcp_metrics_match(pm, net, key))
+			return pm;
+	}
+
+	return NULL;
+}
+
+/* Copies the cached metrics of a path. Returns false if there are none (or
+ * if they are too old).
+ */
+static bool mptcp_metrics_get(const struct net *net,
+			      const struct mptcp_metrics_key *key,
+			      struct mptcp_path_metrics *out)
+{
+	struct mptcp_path_metrics *pm;
+	bool found = false;
+
+	if (!sysctl_mptcp_path_metrics)
+		return false;
+
+	rcu_read_lock();
+	pm = __mptcp_metrics_find(net, key);
+	if (pm && mptcp_metrics_fresh(pm)) {
+		*out = *pm;
+		found = true;
+	}
+	rcu_read_unlock();
+
+	return found;
+}
+
+/* Did the last subflows on this path see heavy loss? */
+static bool mptcp_metrics_path_bad(const struct net *net,
+				   const struct mptcp_metrics_key *key)
+{
+	struct mptcp_path_metrics pm;
+
+	if (!mptcp_metrics_get(net, key, &pm))
+		return false;
+
+	return pm.loss > MPTCP_METRICS_BAD_LOSS;
+}
+
+/* For a subflow that is about to be created from loc to rem */
+bool mptcp_metrics_path_bad4(const struct sock *meta_sk,
+			     const struct mptcp_loc4 *loc,
+			     const struct mptcp_rem4 *rem)
+{
+	struct mptcp_metrics_key key;
+
+	memset(&key, 0, sizeof(key));
+	key.family = AF_INET;
+	key.if_idx = loc->if_idx;
+	key.loc.in = loc->addr;
+	key.rem.in = rem->addr;
+
+	return mptcp_metrics_path_bad(sock_net(meta_sk), &key);
+}
+EXPORT_SYMBOL(mptcp_metrics_path_bad4);
+
+bool mptcp_metrics_path_bad6(const struct sock *meta_sk,
+			     const struct mptcp_loc6 *loc,
+			     const struct mptcp_rem6 *rem)
+{
+	struct mptcp_metrics_key key;
+
+	memset(&key, 0, sizeof(key));
+	key.family = AF_INET6;
+	key.if_idx = loc->if_idx;
+	key.loc.in6 = loc->addr;
+	key.rem.in6 = rem->addr;
+
+	return mptcp_metrics_path_bad(sock_net(meta_sk), &key);
+}
+EXPORT_SYMBOL(mptcp_metrics_path_bad6);
+
+/* Called once the subflow is established (from init_buffer_space) */
+void mptcp_metrics_init_sub(struct sock *sk)
+{
+	struct tcp_sock *tp = tcp_sk(sk);
+	struct mptcp_metrics_key key;
+	struct mptcp_path_metrics pm;
+
+	mptcp_metrics_key(sk, &key);
+	if (!mptcp_metrics_get(sock_net(sk), &key, &pm))
+		return;
+
+	/* No RTT-sample from the handshake - use the one of the path */
+	if (!tp->srtt_us && pm.srtt_us) {
+		tp->srtt_us = pm.srtt_us;
+		tp->mdev_us = pm.rttvar_us;
+		tp->rttvar_us = max(tp->mdev_us, tcp_rto_min_us(sk));
+		tp->mdev_max_us = tp->rttvar_us;
+
+		inet_csk(sk)->icsk_rto = __tcp_set_rto(tp);
+		tcp_bound_rto(sk);
+	}
+
+	/* Half of what the path had, to not overshoot if it changed */
+	if (sysctl_mptcp_path_metrics > 1 && tp->total_retrans <= 1) {
+		u32 cwnd = min(pm.cwnd >> 1, tp->snd_cwnd_clamp);
+
+		if (cwnd > tp->snd_cwnd)
+			tp->snd_cwnd = cwnd;
+	}
+}
+
+static void mptcp_metrics_fill(struct mptcp_path_metrics *pm,
+			       const struct tcp_sock *tp, bool merge)
+{
+	u32 loss = 0;
+	u64 rate = 0;
+
+	if (tp->rate_interval_us)
+		rate = div_u64((u64)tp->rate_delivered * tp->mss_cache *
+			       USEC_PER_SEC, tp->rate_interval_us);
+	if (tp->segs_out)
+		loss = min_t(u64, (u64)tp->total_retrans * MPTCP_METRICS_ONE /
+				  tp->segs_out, MPTCP_METRICS_ONE);
+
+	if (!merge) {
+		pm->srtt_us = tp->srtt_us;
+		pm->rttvar_us = tp->mdev_us;
+		pm->rate = rate;
+		pm->loss = loss;
+		pm->cwnd = tp->snd_cwnd;
+	} else {
+		/* EWMA with a gain of 1/4 */
+		pm->srtt_us = pm->srtt_us - (pm->srtt_us >> 2) + (tp->srtt_us >> 2);
+		pm->rttvar_us = pm->rttvar_us - (pm->rttvar_us >> 2) +
+				(tp->mdev_us >> 2);
+		pm->rate = pm->rate - (pm->rate >> 2) + (rate >> 2);
+		pm->loss = pm->loss - (pm->loss >> 2) + (loss >> 2);
+		pm->cwnd = pm->cwnd - (pm->cwnd >> 2) + (tp->snd_cwnd >> 2);
+	}
+
+	pm->stamp = jiffies;
+}
+
+/* Called when the subflow gets removed from the connection */
+void mptcp_metrics_update(struct sock *sk)
+{
+	const struct tcp_sock *tp = tcp_sk(sk);
+	struct mptcp_path_metrics *pm, *oldest = NULL;
+	struct mptcp_metrics_key key;
+	struct net *net = sock_net(sk);
+	struct hlist_head *head;
+	int depth = 0;
+
+	if (!sysctl_mptcp_path_metrics || !tp->srtt_us ||
+	    tp->segs_out < MPTCP_METRICS_MIN_SEGS)
+		return;
+
+	mptcp_metrics_key(sk, &key);
+	head = mptcp_metrics_bucket(net, &key);
+
+	spin_lock_bh(&mptcp_metrics_lock);
+
+	hlist_for_each_entry(pm, head, node) {
+		if (mptcp_metrics_match(pm, net, &key)) {
+			mptcp_metrics_fill(pm, tp, mptcp_metrics_fresh(pm));
+			goto out;
+		}
+
+		if (!oldest || time_before(pm->stamp, oldest->stamp))
+			oldest = pm;
+		depth++;
+	}
+
+	if (depth >= MPTCP_METRICS_RECLAIM_DEPTH) {
+		/* Readers may see a mix of both paths for a moment, which is
+		 * fine for a cache.
+		 */
+		pm = oldest;
+	} else {
+		pm = kzalloc(sizeof(*pm), GFP_ATOMIC);
+		if (!pm)
+			goto out;
+		hlist_add_head_rcu(&pm->node, head);
+	}
+
+	write_pnet(&pm->net, net);
+	pm->loc = key.loc;
+	pm->rem = key.rem;
+	pm->family = key.family;
+	pm->if_idx = key.if_idx;
+	mptcp_metrics_fill(pm, tp, false);
+
+out:
+	spin_unlock_bh(&mptcp_metrics_lock);
+}
+
+/* Walks the cache of net, calling fill on every fresh entry. *pos allows to
+ * resume the walk (e.g., for netlink-dumps); it is the index of the next
+ * entry. Stops and returns the error as soon as fill fails.
+ */
+int mptcp_metrics_dump(struct net *net, unsigned long *pos,
+		       int (*fill)(const struct mptcp_path_metrics *pm, void *arg),
+		       void *arg)
+{
+	unsigned long idx = 0;
+	int i, ret = 0;
+
+	rcu_read_lock();
+	for (i = 0; i < ARRAY_SIZE(mptcp_metrics_hash); i++) {
+		struct mptcp_path_metrics *pm;
+
+		hlist_for_each_entry_rcu(pm, &mptcp_metrics_hash[i], node) {
+			if (!net_eq(read_pnet(&pm->net), net) ||
+			    !mptcp_metrics_fresh(pm))
+				continue;
+
+			if (idx++ < *pos)
+				continue;
+
+			ret = fill(pm, arg);
+			if (ret)
+				goto out;
+
+			(*pos)++;
+		}
+	}
+out:
+	rcu_read_unlock();
+
+	return ret;
+}
+EXPORT_SYMBOL(mptcp_metrics_dump);
+
+/* Removes the entries of net, of the given family and addresses. A family of
+ * AF_UNSPEC matches all of them, NULL-addresses match any address.
+ */
+void mptcp_metrics_flush(struct net *net, sa_family_t family,
+			 const union inet_addr *loc, const union inet_addr *rem)
+{
+	int i;
+
+	spin_lock_bh(&mptcp_metrics_lock);
+	for (i = 0; i < ARRAY_SIZE(mptcp_metrics_hash); i++) {
+		struct mptcp_path_metrics *pm;
+		struct hlist_node *tmp;
+
+		hlist_for_each_entry_safe(pm, tmp, &mptcp_metrics_hash[i], node) {
+			if (!net_eq(read_pnet(&pm->net), net))
+				continue;
+			if (family != AF_UNSPEC && pm->family != family)
+				continue;
+			if (loc && memcmp(&pm->loc, loc, sizeof(*loc)))
+				continue;
+			if (rem && memcmp(&pm->rem, rem, sizeof(*rem)))
+				continue;
+
+			hlist_del_rcu(&pm->node);
+			kfree_rcu(pm, rcu);
+		}
+	}
+	spin_unlock_bh(&mptcp_metrics_lock);
+}
+EXPORT_SYMBOL(mptcp_metrics_flush);
+
+static void __net_exit mptcp_metrics_exit_net(struct net *net)
+{
+	mptcp_metrics_flush(net, AF_UNSPEC, NULL, NULL);
+}
+
+static struct pernet_operations mptcp_metrics_net_ops = {
+	.exit = mptcp_metrics_exit_net,
+};
+
+int __init mptcp_metrics_init(void)
+{
+	return register_pernet_subsys(&mptcp_metrics_net_ops);
+}
+
+void mptcp_metrics_undo(void)
+{
+	unregister_pernet_subsys(&mptcp_metrics_net_ops);
+}
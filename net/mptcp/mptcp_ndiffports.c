@@ -32,7 +32,7 @@ static void create_subflow_worker(struct work_struct *work)
 						     subflow_work);
 	struct mptcp_cb *mpcb = pm_priv->mpcb;
 	struct sock *meta_sk = mpcb->meta_sk;
-	int iter = 0;
+	int iter = 0, n;
 
 next_subflow:
 	if (iter) {
@@ -56,7 +56,8 @@ static void create_subflow_worker(struct work_struct *work)
 	    !tcp_sk(mpcb->master_sk)->mptcp->fully_established)
 		goto exit;
 
-	if (num_subflows > iter && num_subflows > mptcp_subflow_count(mpcb)) {
+	n = mptcp_policy_num_subflows(mpcb, num_subflows);
+	if (n > iter && n > mptcp_subflow_count(mpcb)) {
 		if (meta_sk->sk_family == AF_INET ||
 		    mptcp_v6_is_v4_mapped(meta_sk)) {
 			struct mptcp_loc4 loc;
@@ -74,6 +75,10 @@ static void create_subflow_worker(struct work_struct *work)
 			rem.port = inet_sk(meta_sk)->inet_dport;
 			rem.rem4_id = 0; /* Default 0 */
 
+			/* A lossy path only gets backup subflows */
+			if (mptcp_metrics_path_bad4(meta_sk, &loc, &rem))
+				loc.low_prio = 1;
+
 			mptcp_init4_subsockets(meta_sk, &loc, &rem);
 		} else {
 #if IS_ENABLED(CONFIG_IPV6)
@@ -92,6 +97,9 @@ static void create_subflow_worker(struct work_struct *work)
 			rem.port = inet_sk(meta_sk)->inet_dport;
 			rem.rem6_id = 0; /* Default 0 */
 
+			if (mptcp_metrics_path_bad6(meta_sk, &loc, &rem))
+				loc.low_prio = 1;
+
 			mptcp_init6_subsockets(meta_sk, &loc, &rem);
 #endif
 		}
@@ -127,7 +135,8 @@ static void ndiffports_create_subflows(struct sock *meta_sk)
 	if (!work_pending(&pm_priv->subflow_work)) {
 		sock_hold(meta_sk);
 		refcount_inc(&mpcb->mpcb_refcnt);
-		queue_work(mptcp_wq, &pm_priv->subflow_work);
+		queue_work_on(mptcp_work_cpu(mpcb, NULL), mptcp_conn_wq,
+			      &pm_priv->subflow_work);
 	}
 }
 
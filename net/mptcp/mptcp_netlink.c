@@ -76,6 +76,30 @@ static const struct nla_policy mptcp_nl_genl_policy[MPTCP_ATTR_MAX + 1] = {
 	[MPTCP_ATTR_FLAGS]	= { .type	= NLA_U16,	},
 	[MPTCP_ATTR_TIMEOUT]	= { .type	= NLA_U32,	},
 	[MPTCP_ATTR_IF_IDX]	= { .type	= NLA_S32,	},
+	[MPTCP_ATTR_COST]	= { .type	= NLA_U8,	},
+	[MPTCP_ATTR_RTT]	= { .type	= NLA_U32,	},
+	[MPTCP_ATTR_RTTVAR]	= { .type	= NLA_U32,	},
+	[MPTCP_ATTR_RATE]	= { .type	= NLA_U64,	},
+	[MPTCP_ATTR_LOSS]	= { .type	= NLA_U32,	},
+	[MPTCP_ATTR_CWND]	= { .type	= NLA_U32,	},
+	[MPTCP_ATTR_AGE]	= { .type	= NLA_U32,	},
+	[MPTCP_ATTR_POLICY_ID]	= { .type	= NLA_U32,	},
+	[MPTCP_ATTR_PRIO]	= { .type	= NLA_U32,	},
+	[MPTCP_ATTR_PREFIXLEN]	= { .type	= NLA_U8,	},
+	[MPTCP_ATTR_MARK]	= { .type	= NLA_U32,	},
+	[MPTCP_ATTR_MARK_MASK]	= { .type	= NLA_U32,	},
+	[MPTCP_ATTR_CGROUP]	= { .type	= NLA_U64,	},
+	[MPTCP_ATTR_SUBFLOWS]	= { .type	= NLA_U8,	},
+	[MPTCP_ATTR_IF_ALLOW]	= { .type	= NLA_BINARY,
+				    .len	= MPTCP_POLICY_MAX_IF * sizeof(s32), },
+	[MPTCP_ATTR_IF_DENY]	= { .type	= NLA_BINARY,
+				    .len	= MPTCP_POLICY_MAX_IF * sizeof(s32), },
+	[MPTCP_ATTR_IF_BACKUP]	= { .type	= NLA_BINARY,
+				    .len	= MPTCP_POLICY_MAX_IF * sizeof(s32), },
+	[MPTCP_ATTR_SCHED]	= { .type	= NLA_NUL_STRING,
+				    .len	= MPTCP_SCHED_NAME_MAX - 1, },
+	[MPTCP_ATTR_REM_TOKEN]	= { .type	= NLA_U32,	},
+	[MPTCP_ATTR_SUBFLOW]	= { .type	= NLA_NESTED,	},
 };
 
 /* Defines the userspace PM filter on events. Set events are ignored. */
@@ -186,6 +210,9 @@ mptcp_nl_put_subsk(struct sk_buff *msg, struct sock *sk)
 	if (nla_put_s32(msg, MPTCP_ATTR_IF_IDX, sk->sk_bound_dev_if))
 		goto nla_put_failure;
 
+	if (nla_put_u8(msg, MPTCP_ATTR_COST, tcp_sk(sk)->mptcp->cost))
+		goto nla_put_failure;
+
 	sk_err = sk->sk_err ? : tcp_sk(sk)->mptcp->sk_err;
 	if (unlikely(sk_err != 0) && meta_sk->sk_state == TCP_ESTABLISHED &&
 	    nla_put_u8(msg, MPTCP_ATTR_ERROR, sk_err))
@@ -955,6 +982,10 @@ mptcp_nl_genl_create(struct sk_buff *skb, struct genl_info *info)
 		goto create_failed;
 	}
 
+	if (subsk && info->attrs[MPTCP_ATTR_COST])
+		tcp_sk(subsk)->mptcp->cost =
+			nla_get_u8(info->attrs[MPTCP_ATTR_COST]);
+
 unlock:
 	release_sock(meta_sk);
 	mutex_unlock(&mpcb->mpcb_mutex);
@@ -1131,6 +1162,15 @@ mptcp_nl_genl_priority(struct sk_buff *skb, struct genl_info *info)
 	lock_sock_nested(meta_sk, SINGLE_DEPTH_NESTING);
 
 	subsk = mptcp_nl_subsk_lookup(mpcb, info->attrs);
+	if (subsk && info->attrs[MPTCP_ATTR_COST]) {
+		tcp_sk(subsk)->mptcp->cost =
+			nla_get_u8(info->attrs[MPTCP_ATTR_COST]);
+
+		/* Only the cost has been changed - nothing to signal */
+		if (!info->attrs[MPTCP_ATTR_BACKUP])
+			goto unlock;
+	}
+
 	if (subsk) {
 		tcp_sk(subsk)->mptcp->send_mp_prio	= 1;
 		tcp_sk(subsk)->mptcp->low_prio		= !!backup;
@@ -1145,6 +1185,7 @@ mptcp_nl_genl_priority(struct sk_buff *skb, struct genl_info *info)
 		ret = -EINVAL;
 	}
 
+unlock:
 	release_sock(meta_sk);
 	mutex_unlock(&mpcb->mpcb_mutex);
 	sock_put(meta_sk);
@@ -1167,6 +1208,400 @@ mptcp_nl_genl_set_filter(struct sk_buff *skb, struct genl_info *info)
 	return 0;
 }
 
+struct mptcp_nl_dump_ctx {
+	struct sk_buff			*skb;
+	struct netlink_callback		*cb;
+};
+
+static int mptcp_nl_metrics_fill(const struct mptcp_path_metrics *pm,
+				 void *arg)
+{
+	struct mptcp_nl_dump_ctx *ctx = arg;
+	struct sk_buff *msg = ctx->skb;
+	void *hdr;
+
+	hdr = genlmsg_put(msg, NETLINK_CB(ctx->cb->skb).portid,
+			  ctx->cb->nlh->nlmsg_seq, &mptcp_genl_family,
+			  NLM_F_MULTI, MPTCP_CMD_METRICS_GET);
+	if (!hdr)
+		return -EMSGSIZE;
+
+	if (nla_put_u16(msg, MPTCP_ATTR_FAMILY, pm->family))
+		goto nla_put_failure;
+
+	if (pm->family == AF_INET) {
+		if (nla_put_u32(msg, MPTCP_ATTR_SADDR4, pm->loc.ip) ||
+		    nla_put_u32(msg, MPTCP_ATTR_DADDR4, pm->rem.ip))
+			goto nla_put_failure;
+	} else {
+		if (nla_put(msg, MPTCP_ATTR_SADDR6, sizeof(pm->loc.in6),
+			    &pm->loc.in6) ||
+		    nla_put(msg, MPTCP_ATTR_DADDR6, sizeof(pm->rem.in6),
+			    &pm->rem.in6))
+			goto nla_put_failure;
+	}
+
+	if (nla_put_s32(msg, MPTCP_ATTR_IF_IDX, pm->if_idx) ||
+	    nla_put_u32(msg, MPTCP_ATTR_RTT, pm->srtt_us >> 3) ||
+	    nla_put_u32(msg, MPTCP_ATTR_RTTVAR, pm->rttvar_us >> 2) ||
+	    nla_put_u64_64bit(msg, MPTCP_ATTR_RATE, pm->rate, MPTCP_ATTR_PAD) ||
+	    nla_put_u32(msg, MPTCP_ATTR_LOSS, pm->loss) ||
+	    nla_put_u32(msg, MPTCP_ATTR_CWND, pm->cwnd) ||
+	    nla_put_u32(msg, MPTCP_ATTR_AGE,
+			jiffies_to_msecs(jiffies - pm->stamp)))
+		goto nla_put_failure;
+
+	genlmsg_end(msg, hdr);
+	return 0;
+
+nla_put_failure:
+	genlmsg_cancel(msg, hdr);
+	return -EMSGSIZE;
+}
+
+static int
+mptcp_nl_genl_metrics_dump(struct sk_buff *skb, struct netlink_callback *cb)
+{
+	struct mptcp_nl_dump_ctx ctx = {
+		.skb	= skb,
+		.cb	= cb,
+	};
+
+	/* The skb being full only means that the dump continues later on */
+	mptcp_metrics_dump(sock_net(skb->sk), &cb->args[0],
+			   mptcp_nl_metrics_fill, &ctx);
+
+	return skb->len;
+}
+
+static int
+mptcp_nl_genl_metrics_flush(struct sk_buff *skb, struct genl_info *info)
+{
+	union inet_addr loc = { 0 }, rem = { 0 };
+	union inet_addr *locp = NULL, *remp = NULL;
+	u16 family = AF_UNSPEC;
+
+	if (info->attrs[MPTCP_ATTR_FAMILY])
+		family = nla_get_u16(info->attrs[MPTCP_ATTR_FAMILY]);
+
+	switch (family) {
+	case AF_UNSPEC:
+		break;
+	case AF_INET:
+		if (info->attrs[MPTCP_ATTR_SADDR4]) {
+			loc.ip = nla_get_u32(info->attrs[MPTCP_ATTR_SADDR4]);
+			locp = &loc;
+		}
+		if (info->attrs[MPTCP_ATTR_DADDR4]) {
+			rem.ip = nla_get_u32(info->attrs[MPTCP_ATTR_DADDR4]);
+			remp = &rem;
+		}
+		break;
+#if IS_ENABLED(CONFIG_IPV6)
+	case AF_INET6:
+		if (info->attrs[MPTCP_ATTR_SADDR6]) {
+			loc.in6 = *(struct in6_addr *)
+				  nla_data(info->attrs[MPTCP_ATTR_SADDR6]);
+			locp = &loc;
+		}
+		if (info->attrs[MPTCP_ATTR_DADDR6]) {
+			rem.in6 = *(struct in6_addr *)
+				  nla_data(info->attrs[MPTCP_ATTR_DADDR6]);
+			remp = &rem;
+		}
+		break;
+#endif
+	default:
+		return -EAFNOSUPPORT;
+	}
+
+	mptcp_metrics_flush(genl_info_net(info), family, locp, remp);
+
+	return 0;
+}
+
+static void mptcp_nl_get_if_list(const struct nlattr *attr, int *list)
+{
+	if (attr)
+		nla_memcpy(list, attr, MPTCP_POLICY_MAX_IF * sizeof(*list));
+}
+
+static int
+mptcp_nl_genl_policy_add(struct sk_buff *skb, struct genl_info *info)
+{
+	struct nlattr **attrs = info->attrs;
+	struct mptcp_policy *pol;
+	int ret;
+
+	if (!attrs[MPTCP_ATTR_POLICY_ID])
+		return -EINVAL;
+
+	pol = kzalloc(sizeof(*pol), GFP_KERNEL);
+	if (!pol)
+		return -ENOMEM;
+
+	pol->id = nla_get_u32(attrs[MPTCP_ATTR_POLICY_ID]);
+	if (attrs[MPTCP_ATTR_PRIO])
+		pol->prio = nla_get_u32(attrs[MPTCP_ATTR_PRIO]);
+	if (attrs[MPTCP_ATTR_FAMILY])
+		pol->family = nla_get_u16(attrs[MPTCP_ATTR_FAMILY]);
+	if (attrs[MPTCP_ATTR_PREFIXLEN])
+		pol->plen = nla_get_u8(attrs[MPTCP_ATTR_PREFIXLEN]);
+
+	if (pol->family == AF_INET && attrs[MPTCP_ATTR_DADDR4]) {
+		pol->daddr.ip = nla_get_u32(attrs[MPTCP_ATTR_DADDR4]);
+	} else if (pol->family == AF_INET6 && attrs[MPTCP_ATTR_DADDR6]) {
+		pol->daddr.in6 = *(struct in6_addr *)
+				 nla_data(attrs[MPTCP_ATTR_DADDR6]);
+	} else if (pol->plen) {
+		ret = -EINVAL;
+		goto out;
+	}
+
+	if (attrs[MPTCP_ATTR_DPORT])
+		pol->dport = htons(nla_get_u16(attrs[MPTCP_ATTR_DPORT]));
+	if (attrs[MPTCP_ATTR_MARK]) {
+		pol->mark = nla_get_u32(attrs[MPTCP_ATTR_MARK]);
+		pol->mark_mask = ~0U;
+	}
+	if (attrs[MPTCP_ATTR_MARK_MASK])
+		pol->mark_mask = nla_get_u32(attrs[MPTCP_ATTR_MARK_MASK]);
+	if (attrs[MPTCP_ATTR_CGROUP])
+		pol->cgroup = nla_get_u64(attrs[MPTCP_ATTR_CGROUP]);
+
+	if (attrs[MPTCP_ATTR_SUBFLOWS])
+		pol->subflows = nla_get_u8(attrs[MPTCP_ATTR_SUBFLOWS]);
+	mptcp_nl_get_if_list(attrs[MPTCP_ATTR_IF_ALLOW], pol->if_allow);
+	mptcp_nl_get_if_list(attrs[MPTCP_ATTR_IF_DENY], pol->if_deny);
+	mptcp_nl_get_if_list(attrs[MPTCP_ATTR_IF_BACKUP], pol->if_backup);
+
+	if (attrs[MPTCP_ATTR_SCHED]) {
+		nla_strlcpy(pol->sched, attrs[MPTCP_ATTR_SCHED],
+			    sizeof(pol->sched));
+		if (!mptcp_sched_available(pol->sched)) {
+			ret = -ENOENT;
+			goto out;
+		}
+	}
+
+	ret = mptcp_policy_add(genl_info_net(info), pol);
+out:
+	kfree(pol);
+	return ret;
+}
+
+static int
+mptcp_nl_genl_policy_del(struct sk_buff *skb, struct genl_info *info)
+{
+	if (!info->attrs[MPTCP_ATTR_POLICY_ID]) {
+		mptcp_policy_flush(genl_info_net(info));
+		return 0;
+	}
+
+	return mptcp_policy_del(genl_info_net(info),
+				nla_get_u32(info->attrs[MPTCP_ATTR_POLICY_ID]));
+}
+
+static int mptcp_nl_put_if_list(struct sk_buff *msg, int attrtype,
+				const int *list)
+{
+	int len = 0;
+
+	while (len < MPTCP_POLICY_MAX_IF && list[len])
+		len++;
+
+	if (!len)
+		return 0;
+
+	return nla_put(msg, attrtype, len * sizeof(*list), list);
+}
+
+static int mptcp_nl_policy_fill(const struct mptcp_policy *pol, void *arg)
+{
+	struct mptcp_nl_dump_ctx *ctx = arg;
+	struct sk_buff *msg = ctx->skb;
+	void *hdr;
+
+	hdr = genlmsg_put(msg, NETLINK_CB(ctx->cb->skb).portid,
+			  ctx->cb->nlh->nlmsg_seq, &mptcp_genl_family,
+			  NLM_F_MULTI, MPTCP_CMD_POLICY_GET);
+	if (!hdr)
+		return -EMSGSIZE;
+
+	if (nla_put_u32(msg, MPTCP_ATTR_POLICY_ID, pol->id) ||
+	    nla_put_u32(msg, MPTCP_ATTR_PRIO, pol->prio) ||
+	    nla_put_u16(msg, MPTCP_ATTR_FAMILY, pol->family) ||
+	    nla_put_u8(msg, MPTCP_ATTR_PREFIXLEN, pol->plen))
+		goto nla_put_failure;
+
+	if (pol->family == AF_INET &&
+	    nla_put_u32(msg, MPTCP_ATTR_DADDR4, pol->daddr.ip))
+		goto nla_put_failure;
+	if (pol->family == AF_INET6 &&
+	    nla_put(msg, MPTCP_ATTR_DADDR6, sizeof(pol->daddr.in6),
+		    &pol->daddr.in6))
+		goto nla_put_failure;
+
+	if (nla_put_u16(msg, MPTCP_ATTR_DPORT, ntohs(pol->dport)) ||
+	    nla_put_u32(msg, MPTCP_ATTR_MARK, pol->mark) ||
+	    nla_put_u32(msg, MPTCP_ATTR_MARK_MASK, pol->mark_mask) ||
+	    nla_put_u64_64bit(msg, MPTCP_ATTR_CGROUP, pol->cgroup,
+			      MPTCP_ATTR_PAD) ||
+	    nla_put_u8(msg, MPTCP_ATTR_SUBFLOWS, pol->subflows) ||
+	    mptcp_nl_put_if_list(msg, MPTCP_ATTR_IF_ALLOW, pol->if_allow) ||
+	    mptcp_nl_put_if_list(msg, MPTCP_ATTR_IF_DENY, pol->if_deny) ||
+	    mptcp_nl_put_if_list(msg, MPTCP_ATTR_IF_BACKUP, pol->if_backup))
+		goto nla_put_failure;
+
+	if (pol->sched[0] && nla_put_string(msg, MPTCP_ATTR_SCHED, pol->sched))
+		goto nla_put_failure;
+
+	genlmsg_end(msg, hdr);
+	return 0;
+
+nla_put_failure:
+	genlmsg_cancel(msg, hdr);
+	return -EMSGSIZE;
+}
+
+static int
+mptcp_nl_genl_policy_dump(struct sk_buff *skb, struct netlink_callback *cb)
+{
+	struct mptcp_nl_dump_ctx ctx = {
+		.skb	= skb,
+		.cb	= cb,
+	};
+
+	mptcp_policy_dump(sock_net(skb->sk), &cb->args[0],
+			  mptcp_nl_policy_fill, &ctx);
+
+	return skb->len;
+}
+
+static int mptcp_nl_put_meta(struct sk_buff *msg, const struct sock *meta_sk)
+{
+	const struct inet_sock *isk = inet_sk(meta_sk);
+
+	if (meta_sk->sk_family == AF_INET || mptcp_v6_is_v4_mapped(meta_sk)) {
+		if (nla_put_u16(msg, MPTCP_ATTR_FAMILY, AF_INET) ||
+		    nla_put_u32(msg, MPTCP_ATTR_SADDR4, isk->inet_saddr) ||
+		    nla_put_u32(msg, MPTCP_ATTR_DADDR4, isk->inet_daddr))
+			return -1;
+	}
+#if IS_ENABLED(CONFIG_IPV6)
+	else {
+		if (nla_put_u16(msg, MPTCP_ATTR_FAMILY, AF_INET6) ||
+		    nla_put(msg, MPTCP_ATTR_SADDR6,
+			    sizeof(meta_sk->sk_v6_rcv_saddr),
+			    &meta_sk->sk_v6_rcv_saddr) ||
+		    nla_put(msg, MPTCP_ATTR_DADDR6, sizeof(meta_sk->sk_v6_daddr),
+			    &meta_sk->sk_v6_daddr))
+			return -1;
+	}
+#endif
+
+	if (nla_put_u16(msg, MPTCP_ATTR_SPORT, ntohs(isk->inet_sport)) ||
+	    nla_put_u16(msg, MPTCP_ATTR_DPORT, ntohs(isk->inet_dport)))
+		return -1;
+
+	return 0;
+}
+
+static int mptcp_nl_session_fill(struct sk_buff *msg,
+				 struct netlink_callback *cb,
+				 struct sock *meta_sk)
+{
+	struct mptcp_cb *mpcb = tcp_sk(meta_sk)->mpcb;
+	struct mptcp_tcp_sock *mptcp;
+	void *hdr;
+
+	hdr = genlmsg_put(msg, NETLINK_CB(cb->skb).portid, cb->nlh->nlmsg_seq,
+			  &mptcp_genl_family, NLM_F_MULTI,
+			  MPTCP_CMD_SESSION_GET);
+	if (!hdr)
+		return -EMSGSIZE;
+
+	if (nla_put_u32(msg, MPTCP_ATTR_TOKEN, mpcb->mptcp_loc_token) ||
+	    nla_put_u32(msg, MPTCP_ATTR_REM_TOKEN, mpcb->mptcp_rem_token) ||
+	    mptcp_nl_put_meta(msg, meta_sk))
+		goto nla_put_failure;
+
+	mptcp_for_each_sub(mpcb, mptcp) {
+		struct nlattr *nest;
+
+		nest = nla_nest_start(msg, MPTCP_ATTR_SUBFLOW);
+		if (!nest || mptcp_nl_put_subsk(msg, mptcp_to_sock(mptcp)))
+			goto nla_put_failure;
+		nla_nest_end(msg, nest);
+	}
+
+	genlmsg_end(msg, hdr);
+	return 0;
+
+nla_put_failure:
+	genlmsg_cancel(msg, hdr);
+	return -EMSGSIZE;
+}
+
+/* Walks the token-table one bucket at a time, so that neither RCU nor BH are
+ * held across the whole table. cb->args[0] is the bucket and cb->args[1] the
+ * index in the bucket to resume from.
+ */
+static int
+mptcp_nl_genl_session_dump(struct sk_buff *skb, struct netlink_callback *cb)
+{
+	const struct net *net = sock_net(skb->sk);
+	unsigned long bucket = cb->args[0];
+	unsigned long skip = cb->args[1];
+
+	for (; bucket <= mptcp_tk_htable.mask; bucket++, skip = 0) {
+		struct hlist_nulls_node *node;
+		struct tcp_sock *meta_tp;
+		unsigned long idx = 0;
+		bool full = false;
+
+		rcu_read_lock();
+		local_bh_disable();
+		hlist_nulls_for_each_entry_rcu(meta_tp, node,
+					       &mptcp_tk_htable.hashtable[bucket],
+					       tk_table) {
+			struct sock *meta_sk = (struct sock *)meta_tp;
+
+			if (!mptcp(meta_tp) || !meta_tp->mpcb ||
+			    !net_eq(net, sock_net(meta_sk)))
+				continue;
+
+			if (idx++ < skip)
+				continue;
+
+			if (mptcp_nl_session_fill(skb, cb, meta_sk)) {
+				full = true;
+				break;
+			}
+		}
+		local_bh_enable();
+		rcu_read_unlock();
+
+		if (full) {
+			/* A session that doesn't fit in an empty message would
+			 * otherwise silently end the dump.
+			 */
+			if (!skb->len)
+				return -EMSGSIZE;
+
+			skip = idx - 1;
+			break;
+		}
+
+		cond_resched();
+	}
+
+	cb->args[0] = bucket;
+	cb->args[1] = skip;
+
+	return skb->len;
+}
+
 static struct genl_ops mptcp_genl_ops[] = {
 	{
 		.cmd	= MPTCP_CMD_ANNOUNCE,
@@ -1203,6 +1638,36 @@ static struct genl_ops mptcp_genl_ops[] = {
 		.doit	= mptcp_nl_genl_conn_exists,
 		.flags	= GENL_ADMIN_PERM,
 	},
+	{
+		.cmd	= MPTCP_CMD_METRICS_GET,
+		.dumpit	= mptcp_nl_genl_metrics_dump,
+		.flags	= GENL_ADMIN_PERM,
+	},
+	{
+		.cmd	= MPTCP_CMD_METRICS_FLUSH,
+		.doit	= mptcp_nl_genl_metrics_flush,
+		.flags	= GENL_ADMIN_PERM,
+	},
+	{
+		.cmd	= MPTCP_CMD_POLICY_ADD,
+		.doit	= mptcp_nl_genl_policy_add,
+		.flags	= GENL_ADMIN_PERM,
+	},
+	{
+		.cmd	= MPTCP_CMD_POLICY_DEL,
+		.doit	= mptcp_nl_genl_policy_del,
+		.flags	= GENL_ADMIN_PERM,
+	},
+	{
+		.cmd	= MPTCP_CMD_POLICY_GET,
+		.dumpit	= mptcp_nl_genl_policy_dump,
+		.flags	= GENL_ADMIN_PERM,
+	},
+	{
+		.cmd	= MPTCP_CMD_SESSION_GET,
+		.dumpit	= mptcp_nl_genl_session_dump,
+		.flags	= GENL_ADMIN_PERM,
+	},
 };
 
 static struct mptcp_pm_ops mptcp_nl_pm_ops = {
@@ -59,8 +59,9 @@ static u32 mptcp_get_crt_cwnd(struct sock *sk)
 }
 
 /* return the dominator of the first term of  the increasing term */
-static u64 mptcp_get_rate(const struct mptcp_cb *mpcb , u32 path_rtt)
+static u64 mptcp_get_rate(const struct sock *cur_sk, u32 path_rtt)
 {
+	const struct mptcp_cb *mpcb = tcp_sk(cur_sk)->mpcb;
 	struct mptcp_tcp_sock *mptcp;
 	u64 rate = 1; /* We have to avoid a zero-rate because it is used as a divisor */
 
@@ -70,7 +71,7 @@ static u64 mptcp_get_rate(const struct mptcp_cb *mpcb , u32 path_rtt)
 		u64 scaled_num;
 		u32 tmp_cwnd;
 
-		if (!mptcp_olia_sk_can_send(sk))
+		if (!mptcp_olia_sk_can_send(sk) || !mptcp_sbd_coupled(cur_sk, sk))
 			continue;
 
 		tmp_cwnd = mptcp_get_crt_cwnd(sk);
@@ -82,8 +83,9 @@ static u64 mptcp_get_rate(const struct mptcp_cb *mpcb , u32 path_rtt)
 }
 
 /* find the maximum cwnd, used to find set M */
-static u32 mptcp_get_max_cwnd(const struct mptcp_cb *mpcb)
+static u32 mptcp_get_max_cwnd(const struct sock *cur_sk)
 {
+	const struct mptcp_cb *mpcb = tcp_sk(cur_sk)->mpcb;
 	struct mptcp_tcp_sock *mptcp;
 	u32 best_cwnd = 0;
 
@@ -91,7 +93,7 @@ static u32 mptcp_get_max_cwnd(const struct mptcp_cb *mpcb)
 		struct sock *sk = mptcp_to_sock(mptcp);
 		u32 tmp_cwnd;
 
-		if (!mptcp_olia_sk_can_send(sk))
+		if (!mptcp_olia_sk_can_send(sk) || !mptcp_sbd_coupled(cur_sk, sk))
 			continue;
 
 		tmp_cwnd = mptcp_get_crt_cwnd(sk);
@@ -101,8 +103,10 @@ static u32 mptcp_get_max_cwnd(const struct mptcp_cb *mpcb)
 	return best_cwnd;
 }
 
-static void mptcp_get_epsilon(const struct mptcp_cb *mpcb)
+/* Only the subflows coupled with cur_sk are taken into account (and updated) */
+static void mptcp_get_epsilon(const struct sock *cur_sk)
 {
+	const struct mptcp_cb *mpcb = tcp_sk(cur_sk)->mpcb;
 	struct mptcp_tcp_sock *mptcp;
 	struct mptcp_olia *ca;
 	struct tcp_sock *tp;
@@ -113,7 +117,7 @@ static void mptcp_get_epsilon(const struct mptcp_cb *mpcb)
 
 	/* TODO - integrate this in the following loop - we just want to iterate once */
 
-	max_cwnd = mptcp_get_max_cwnd(mpcb);
+	max_cwnd = mptcp_get_max_cwnd(cur_sk);
 
 	/* find the best path */
 	mptcp_for_each_sub(mpcb, mptcp) {
@@ -121,7 +125,7 @@ static void mptcp_get_epsilon(const struct mptcp_cb *mpcb)
 		tp = tcp_sk(sk);
 		ca = inet_csk_ca(sk);
 
-		if (!mptcp_olia_sk_can_send(sk))
+		if (!mptcp_olia_sk_can_send(sk) || !mptcp_sbd_coupled(cur_sk, sk))
 			continue;
 
 		established_cnt++;
@@ -144,7 +148,7 @@ static void mptcp_get_epsilon(const struct mptcp_cb *mpcb)
 		tp = tcp_sk(sk);
 		ca = inet_csk_ca(sk);
 
-		if (!mptcp_olia_sk_can_send(sk))
+		if (!mptcp_olia_sk_can_send(sk) || !mptcp_sbd_coupled(cur_sk, sk))
 			continue;
 
 		tmp_cwnd = mptcp_get_crt_cwnd(sk);
@@ -166,7 +170,7 @@ static void mptcp_get_epsilon(const struct mptcp_cb *mpcb)
 		tp = tcp_sk(sk);
 		ca = inet_csk_ca(sk);
 
-		if (!mptcp_olia_sk_can_send(sk))
+		if (!mptcp_olia_sk_can_send(sk) || !mptcp_sbd_coupled(cur_sk, sk))
 			continue;
 
 		if (B_not_M == 0) {
@@ -232,7 +236,6 @@ static void mptcp_olia_cong_avoid(struct sock *sk, u32 ack, u32 acked)
 {
 	struct tcp_sock *tp = tcp_sk(sk);
 	struct mptcp_olia *ca = inet_csk_ca(sk);
-	const struct mptcp_cb *mpcb = tp->mpcb;
 
 	u64 inc_num, inc_den, rate, cwnd_scaled;
 
@@ -252,8 +255,8 @@ static void mptcp_olia_cong_avoid(struct sock *sk, u32 ack, u32 acked)
 		return;
 	}
 
-	mptcp_get_epsilon(mpcb);
-	rate = mptcp_get_rate(mpcb, tp->srtt_us);
+	mptcp_get_epsilon(sk);
+	rate = mptcp_get_rate(sk, tp->srtt_us);
 	cwnd_scaled = mptcp_olia_scale(tp->snd_cwnd, scale);
 	inc_den = ca->epsilon_den * tp->snd_cwnd * rate ? : 1;
 
@@ -293,6 +296,7 @@ static struct tcp_congestion_ops mptcp_olia = {
 	.ssthresh	= tcp_reno_ssthresh,
 	.cong_avoid	= mptcp_olia_cong_avoid,
 	.undo_cwnd	= tcp_reno_undo_cwnd,
+	.pkts_acked	= mptcp_sbd_pkts_acked,
 	.set_state	= mptcp_olia_set_state,
 	.owner		= THIS_MODULE,
 	.name		= "olia",
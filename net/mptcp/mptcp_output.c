@@ -295,6 +295,7 @@ void mptcp_reinject_data(struct sock *sk, int clone_it)
 	struct sock *meta_sk = mptcp_meta_sk(sk);
 	struct sk_buff *skb_it, *tmp;
 	enum tcp_queue tcp_queue;
+	u32 segs = 0;
 
 	/* It has already been closed - there is really no point in reinjecting */
 	if (meta_sk->sk_state == TCP_CLOSE)
@@ -318,6 +319,7 @@ void mptcp_reinject_data(struct sock *sk, int clone_it)
 		tcb->mptcp_flags |= MPTCP_REINJECT;
 		__mptcp_reinject_data(skb_it, meta_sk, sk, clone_it,
 				      TCP_FRAG_IN_WRITE_QUEUE);
+		segs++;
 	}
 
 	skb_it = tcp_rtx_queue_head(sk);
@@ -340,6 +342,7 @@ void mptcp_reinject_data(struct sock *sk, int clone_it)
 		tcb->mptcp_flags |= MPTCP_REINJECT;
 		__mptcp_reinject_data(skb_it, meta_sk, sk, clone_it,
 				      TCP_FRAG_IN_RTX_QUEUE);
+		segs++;
 	}
 
 	skb_it = tcp_write_queue_tail(meta_sk);
@@ -358,6 +361,10 @@ void mptcp_reinject_data(struct sock *sk, int clone_it)
 
 	tcp_sk(sk)->pf = 1;
 
+	if (segs)
+		tcp_call_bpf_2arg(sk, BPF_SOCK_OPS_MPTCP_REINJECT_CB, segs,
+				  clone_it);
+
 	mptcp_push_pending_frames(meta_sk);
 }
 EXPORT_SYMBOL(mptcp_reinject_data);
@@ -432,27 +439,43 @@ static int mptcp_write_dss_mapping(const struct tcp_sock *tp, const struct sk_bu
 	return ptr - start;
 }
 
+#define MPTCP_DSS_TMPL_M	0x1
+#define MPTCP_DSS_TMPL_F	0x2
+
+/* The first word of the DSS-option only depends on the F- and M-flags and on
+ * whether the checksum is in use. Thus, it is built once per subflow and
+ * whenever dss_csum gets negotiated.
+ */
+void mptcp_init_dss_tmpl(struct tcp_sock *tp)
+{
+	int i;
+
+	for (i = 0; i < ARRAY_SIZE(tp->mptcp->dss_tmpl); i++) {
+		struct mp_dss *mdss = (struct mp_dss *)&tp->mptcp->dss_tmpl[i];
+
+		mdss->kind = TCPOPT_MPTCP;
+		mdss->sub = MPTCP_SUB_DSS;
+		mdss->rsv1 = 0;
+		mdss->rsv2 = 0;
+		mdss->F = !!(i & MPTCP_DSS_TMPL_F);
+		mdss->m = 0;
+		mdss->M = !!(i & MPTCP_DSS_TMPL_M);
+		mdss->a = 0;
+		mdss->A = 1;
+		mdss->len = mptcp_sub_len_dss(mdss, tp->mpcb->dss_csum);
+	}
+}
+
 static int mptcp_write_dss_data_ack(const struct tcp_sock *tp, const struct sk_buff *skb,
 				    __be32 *ptr)
 {
-	struct mp_dss *mdss = (struct mp_dss *)ptr;
-	__be32 *start = ptr;
-
-	mdss->kind = TCPOPT_MPTCP;
-	mdss->sub = MPTCP_SUB_DSS;
-	mdss->rsv1 = 0;
-	mdss->rsv2 = 0;
-	mdss->F = mptcp_is_data_fin(skb) ? 1 : 0;
-	mdss->m = 0;
-	mdss->M = mptcp_is_data_seq(skb) ? 1 : 0;
-	mdss->a = 0;
-	mdss->A = 1;
-	mdss->len = mptcp_sub_len_dss(mdss, tp->mpcb->dss_csum);
-	ptr++;
+	int idx = (mptcp_is_data_fin(skb) ? MPTCP_DSS_TMPL_F : 0) |
+		  (mptcp_is_data_seq(skb) ? MPTCP_DSS_TMPL_M : 0);
 
-	*ptr++ = htonl(mptcp_meta_tp(tp)->rcv_nxt);
+	ptr[0] = tp->mptcp->dss_tmpl[idx];
+	ptr[1] = htonl(mptcp_meta_tp(tp)->rcv_nxt);
 
-	return ptr - start;
+	return 2;
 }
 
 /* RFC6824 states that once a particular subflow mapping has been sent
@@ -722,7 +745,7 @@ int mptcp_write_wakeup(struct sock *meta_sk, int mib)
 	    before(TCP_SKB_CB(skb)->seq, tcp_wnd_end(meta_tp))) {
 		unsigned int mss;
 		unsigned int seg_size = tcp_wnd_end(meta_tp) - TCP_SKB_CB(skb)->seq;
-		struct sock *subsk = meta_tp->mpcb->sched_ops->get_subflow(meta_sk, skb, true);
+		struct sock *subsk = mptcp_sched_get_subflow(meta_sk, skb, true);
 		struct tcp_sock *subtp;
 
 		WARN_ON(TCP_SKB_CB(skb)->sacked);
@@ -820,8 +843,11 @@ bool mptcp_write_xmit(struct sock *meta_sk, unsigned int mss_now, int nonagle,
 			mptcp_retransmit_skb(meta_sk, tcp_rtx_queue_head(meta_sk));
 	}
 
-	while ((skb = mpcb->sched_ops->next_segment(meta_sk, &reinject, &subsk,
-						    &sublimit))) {
+	if (unlikely(mpcb->parked_cnt))
+		mptcp_unpark_check(meta_sk);
+
+	while ((skb = mptcp_sched_next_segment(meta_sk, &reinject, &subsk,
+					       &sublimit))) {
 		enum tcp_queue tcp_queue = TCP_FRAG_IN_WRITE_QUEUE;
 		unsigned int limit;
 
@@ -911,6 +937,16 @@ bool mptcp_write_xmit(struct sock *meta_sk, unsigned int mss_now, int nonagle,
 		if (!mptcp_skb_entail(subsk, skb, reinject))
 			break;
 
+		if (reinject == 1) {
+			mpcb->reinjects_sent++;
+		} else if (reinject == -1) {
+			mpcb->opti_retrans++;
+			mpcb->opti_retrans_bytes += skb->len;
+			MPTCP_INC_STATS(sock_net(meta_sk), MPTCP_MIB_OPTIRETRANS);
+			MPTCP_ADD_STATS(sock_net(meta_sk), MPTCP_MIB_OPTIRETRANSBYTES,
+					skb->len);
+		}
+
 		if (reinject <= 0)
 			tcp_update_skb_after_send(meta_sk, skb, meta_tp->tcp_wstamp_ns);
 		meta_tp->lsndtime = tcp_jiffies32;
@@ -1103,6 +1139,7 @@ void mptcp_established_options(struct sock *sk, struct sk_buff *skb,
 	struct tcp_sock *tp = tcp_sk(sk);
 	struct mptcp_cb *mpcb = tp->mpcb;
 	const struct tcp_skb_cb *tcb = skb ? TCP_SKB_CB(skb) : NULL;
+	bool early_data = false;
 
 	/* We are coming from tcp_current_mss with the meta_sk as an argument.
 	 * It does not make sense to check for the options, because when the
@@ -1162,7 +1199,22 @@ void mptcp_established_options(struct sock *sk, struct sk_buff *skb,
 		if (skb)
 			tp->mptcp->include_mpc = 0;
 	}
-	if (unlikely(tp->mptcp->pre_established) &&
+	/* Early data has no room for the MP_JOIN next to the DSS-option. The
+	 * third ACK keeps on being retransmitted by the mptcp_ack_timer until
+	 * the peer acknowledges it. If the peer never got it, it resets the
+	 * subflow and the data is reinjected on the others.
+	 */
+	if (unlikely(tp->mptcp->pre_established) && tp->mptcp->join_early &&
+	    (!skb || mptcp_is_data_seq(skb))) {
+		early_data = true;
+
+		if (skb && !tp->mptcp->join_early_sent) {
+			tp->mptcp->join_early_sent = 1;
+			MPTCP_INC_STATS(sock_net(sk), MPTCP_MIB_JOINEARLYDATA);
+		}
+	}
+
+	if (unlikely(tp->mptcp->pre_established) && !early_data &&
 	    (!skb || !(tcb->tcp_flags & (TCPHDR_FIN | TCPHDR_RST)))) {
 		opts->options |= OPTION_MPTCP;
 		opts->mptcp_options |= OPTION_MP_JOIN | OPTION_TYPE_ACK;
@@ -1178,7 +1230,8 @@ void mptcp_established_options(struct sock *sk, struct sk_buff *skb,
 			return;
 	}
 
-	if (!tp->mptcp->include_mpc && !tp->mptcp->pre_established) {
+	if (!tp->mptcp->include_mpc &&
+	    (!tp->mptcp->pre_established || early_data)) {
 		opts->options |= OPTION_MPTCP;
 		opts->mptcp_options |= OPTION_DATA_ACK;
 		/* If !skb, we come from tcp_current_mss and thus we always
@@ -1553,6 +1606,19 @@ static void mptcp_ack_retransmit_timer(struct sock *sk)
 
 	if (tcp_write_timeout(sk)) {
 		MPTCP_INC_STATS(sock_net(sk), MPTCP_MIB_JOINACKRTO);
+
+		/* The data we sent may never have been accepted by the peer.
+		 * Only this subflow goes away, the meta stays untouched.
+		 */
+		if (tp->mptcp->join_early_sent) {
+			MPTCP_INC_STATS(sock_net(sk), MPTCP_MIB_JOINEARLYFAIL);
+			tp->mptcp->join_early_sent = 0;
+			mptcp_reinject_data(sk, 0);
+			tp->ops->send_active_reset(sk, GFP_ATOMIC);
+			mptcp_sub_force_close(sk);
+			goto out;
+		}
+
 		tp->mptcp->pre_established = 0;
 		sk_stop_timer(sk, &tp->mptcp->mptcp_ack_timer);
 		tp->ops->send_active_reset(sk, GFP_ATOMIC);
@@ -1651,7 +1717,7 @@ int mptcp_retransmit_skb(struct sock *meta_sk, struct sk_buff *skb)
 	/* We need to make sure that the retransmitted segment can be sent on a
 	 * subflow right now. If it is too big, it needs to be fragmented.
 	 */
-	subsk = meta_tp->mpcb->sched_ops->get_subflow(meta_sk, skb, false);
+	subsk = mptcp_sched_get_subflow(meta_sk, skb, false);
 	if (!subsk) {
 		/* We want to increase icsk_retransmits, thus return 0, so that
 		 * mptcp_meta_retransmit_timer enters the desired branch.
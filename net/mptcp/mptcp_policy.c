@@ -0,0 +1,416 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ *	MPTCP implementation - Path-manager policy table
+ *
+ *	Rules match on the destination prefix and port, the socket-mark and
+ *	the cgroup of a connection. The matching rule with the lowest priority
+ *	is taken when the MPTCP-session gets created and it then tells the
+ *	path-managers how many subflows to create, which interfaces to use
+ *	(or to use only as backup) and which scheduler to use.
+ *
+ *	Rules are hashed by (family, prefix-length, masked destination), so a
+ *	lookup costs one hash-lookup per prefix-length in use - not one per
+ *	rule.
+ *
+ *	This program is free software; you can redistribute it and/or
+ *      modify it under the terms of the GNU General Public License
+ *      as published by the Free Software Foundation; either version
+ *      2 of the License, or (at your option) any later version.
+ */
+
+#include <linux/cgroup.h>
+#include <linux/jhash.h>
+#include <linux/slab.h>
+#include <net/ipv6.h>
+#include <net/mptcp.h>
+#include <net/tcp.h>
+
+#define MPTCP_POLICY_HASH_BITS	8
+
+static struct hlist_head mptcp_policy_hash[1 << MPTCP_POLICY_HASH_BITS];
+static DEFINE_MUTEX(mptcp_policy_mutex);
+
+/* Prefix-lengths in use, and the number of rules per prefix-length */
+static DECLARE_BITMAP(mptcp_policy_plen4, 33);
+static DECLARE_BITMAP(mptcp_policy_plen6, 129);
+static unsigned int mptcp_policy_cnt4[33];
+static unsigned int mptcp_policy_cnt6[129];
+static unsigned int mptcp_policy_cnt_any;
+
+struct mptcp_policy_key {
+	union inet_addr	daddr;
+	sa_family_t	family;
+	__be16		dport;
+	u32		mark;
+	u64		cgroup;
+};
+
+static void mptcp_policy_mask(sa_family_t family, const union inet_addr *addr,
+			      u8 plen, union inet_addr *out)
+{
+	memset(out, 0, sizeof(*out));
+
+	if (family == AF_INET && plen)
+		out->ip = addr->ip & htonl(~0U << (32 - plen));
+#if IS_ENABLED(CONFIG_IPV6)
+	else if (family == AF_INET6)
+		ipv6_addr_prefix(&out->in6, &addr->in6, plen);
+#endif
+}
+
+static struct hlist_head *mptcp_policy_bucket(const struct net *net,
+					      sa_family_t family, u8 plen,
+					      const union inet_addr *masked)
+{
+	u32 hash = jhash2(masked->all, 4,
+			  net_hash_mix(net) ^ (family << 8 | plen));
+
+	return &mptcp_policy_hash[hash_32(hash, MPTCP_POLICY_HASH_BITS)];
+}
+
+static void mptcp_policy_key(const struct sock *meta_sk,
+			     struct mptcp_policy_key *key)
+{
+	memset(key, 0, sizeof(*key));
+
+	if (meta_sk->sk_family == AF_INET || mptcp_v6_is_v4_mapped(meta_sk)) {
+		key->family = AF_INET;
+		key->daddr.ip = inet_sk(meta_sk)->inet_daddr;
+	}
+#if IS_ENABLED(CONFIG_IPV6)
+	else {
+		key->family = AF_INET6;
+		key->daddr.in6 = meta_sk->sk_v6_daddr;
+	}
+#endif
+	key->dport = inet_sk(meta_sk)->inet_dport;
+	key->mark = meta_sk->sk_mark;
+#ifdef CONFIG_SOCK_CGROUP_DATA
+	key->cgroup = sock_cgroup_ptr((struct sock_cgroup_data *)
+				      &meta_sk->sk_cgrp_data)->kn->id.id;
+#endif
+}
+
+static bool mptcp_policy_match(const struct mptcp_policy *pol,
+			       const struct net *net,
+			       const struct mptcp_policy_key *key)
+{
+	if (!net_eq(read_pnet(&pol->net), net))
+		return false;
+	if (pol->dport && pol->dport != key->dport)
+		return false;
+	if ((key->mark & pol->mark_mask) != pol->mark)
+		return false;
+	if (pol->cgroup && pol->cgroup != key->cgroup)
+		return false;
+
+	return true;
+}
+
+/* Must be called under rcu_read_lock */
+static void mptcp_policy_scan(struct hlist_head *head, const struct net *net,
+			      sa_family_t family, u8 plen,
+			      const union inet_addr *masked,
+			      const struct mptcp_policy_key *key,
+			      struct mptcp_policy **best)
+{
+	struct mptcp_policy *pol;
+
+	hlist_for_each_entry_rcu(pol, head, node) {
+		if (pol->family != family || pol->plen != plen ||
+		    memcmp(&pol->daddr, masked, sizeof(*masked)))
+			continue;
+
+		if (!mptcp_policy_match(pol, net, key))
+			continue;
+
+		if (!*best || pol->prio < (*best)->prio)
+			*best = pol;
+	}
+}
+
+static struct mptcp_policy *mptcp_policy_lookup(const struct sock *meta_sk)
+{
+	const struct net *net = sock_net(meta_sk);
+	struct mptcp_policy *best = NULL;
+	struct mptcp_policy_key key;
+	union inet_addr masked;
+	unsigned long *plens;
+	unsigned int plen, max;
+
+	mptcp_policy_key(meta_sk, &key);
+
+	rcu_read_lock();
+	if (READ_ONCE(mptcp_policy_cnt_any)) {
+		memset(&masked, 0, sizeof(masked));
+		mptcp_policy_scan(mptcp_policy_bucket(net, AF_UNSPEC, 0, &masked),
+				  net, AF_UNSPEC, 0, &masked, &key, &best);
+	}
+
+	if (key.family == AF_INET) {
+		plens = mptcp_policy_plen4;
+		max = 33;
+	} else {
+		plens = mptcp_policy_plen6;
+		max = 129;
+	}
+
+	for_each_set_bit(plen, plens, max) {
+		mptcp_policy_mask(key.family, &key.daddr, plen, &masked);
+		mptcp_policy_scan(mptcp_policy_bucket(net, key.family, plen,
+						      &masked),
+				  net, key.family, plen, &masked, &key, &best);
+	}
+
+	if (best && !refcount_inc_not_zero(&best->refcnt))
+		best = NULL;
+	rcu_read_unlock();
+
+	return best;
+}
+
+void mptcp_policy_put(struct mptcp_policy *pol)
+{
+	if (pol && refcount_dec_and_test(&pol->refcnt))
+		kfree_rcu(pol, rcu);
+}
+
+/* Called upon the creation of the MPTCP-session */
+void mptcp_policy_apply(struct mptcp_cb *mpcb)
+{
+	mpcb->policy = mptcp_policy_lookup(mpcb->meta_sk);
+}
+
+int mptcp_policy_num_subflows(const struct mptcp_cb *mpcb, int def)
+{
+	if (mpcb->policy && mpcb->policy->subflows)
+		return mpcb->policy->subflows;
+
+	return def;
+}
+EXPORT_SYMBOL(mptcp_policy_num_subflows);
+
+static bool mptcp_policy_if_in(const int *list, int if_idx)
+{
+	int i;
+
+	for (i = 0; i < MPTCP_POLICY_MAX_IF && list[i]; i++) {
+		if (list[i] == if_idx)
+			return true;
+	}
+
+	return false;
+}
+
+/* May a subflow be created over this interface? */
+bool mptcp_policy_if_allowed(const struct mptcp_cb *mpcb, int if_idx)
+{
+	const struct mptcp_policy *pol = mpcb->policy;
+
+	if (!pol || !if_idx)
+		return true;
+
+	if (mptcp_policy_if_in(pol->if_deny, if_idx))
+		return false;
+
+	return !pol->if_allow[0] || mptcp_policy_if_in(pol->if_allow, if_idx);
+}
+EXPORT_SYMBOL(mptcp_policy_if_allowed);
+
+bool mptcp_policy_if_backup(const struct mptcp_cb *mpcb, int if_idx)
+{
+	return mpcb->policy && if_idx &&
+	       mptcp_policy_if_in(mpcb->policy->if_backup, if_idx);
+}
+EXPORT_SYMBOL(mptcp_policy_if_backup);
+
+/* Must be called with mptcp_policy_mutex held */
+static void mptcp_policy_count(const struct mptcp_policy *pol, int delta)
+{
+	unsigned int *cnt;
+	unsigned long *plens;
+
+	if (pol->family == AF_UNSPEC) {
+		WRITE_ONCE(mptcp_policy_cnt_any, mptcp_policy_cnt_any + delta);
+		return;
+	}
+
+	if (pol->family == AF_INET) {
+		cnt = &mptcp_policy_cnt4[pol->plen];
+		plens = mptcp_policy_plen4;
+	} else {
+		cnt = &mptcp_policy_cnt6[pol->plen];
+		plens = mptcp_policy_plen6;
+	}
+
+	*cnt += delta;
+	if (*cnt)
+		set_bit(pol->plen, plens);
+	else
+		clear_bit(pol->plen, plens);
+}
+
+/* Must be called with mptcp_policy_mutex held */
+static void mptcp_policy_unlink(struct mptcp_policy *pol)
+{
+	hlist_del_rcu(&pol->node);
+	mptcp_policy_count(pol, -1);
+	mptcp_policy_put(pol);
+}
+
+/* Must be called with mptcp_policy_mutex held */
+static struct mptcp_policy *mptcp_policy_find_id(const struct net *net, u32 id)
+{
+	int i;
+
+	for (i = 0; i < ARRAY_SIZE(mptcp_policy_hash); i++) {
+		struct mptcp_policy *pol;
+
+		hlist_for_each_entry(pol, &mptcp_policy_hash[i], node) {
+			if (pol->id == id && net_eq(read_pnet(&pol->net), net))
+				return pol;
+		}
+	}
+
+	return NULL;
+}
+
+/* Adds a copy of tmpl to the table of net, replacing the rule with the same
+ * id. Established connections keep the rule they were created with.
+ */
+int mptcp_policy_add(struct net *net, const struct mptcp_policy *tmpl)
+{
+	struct mptcp_policy *pol, *old;
+
+	switch (tmpl->family) {
+	case AF_UNSPEC:
+		if (tmpl->plen)
+			return -EINVAL;
+		break;
+	case AF_INET:
+		if (tmpl->plen > 32)
+			return -EINVAL;
+		break;
+#if IS_ENABLED(CONFIG_IPV6)
+	case AF_INET6:
+		if (tmpl->plen > 128)
+			return -EINVAL;
+		break;
+#endif
+	default:
+		return -EAFNOSUPPORT;
+	}
+
+	if (tmpl->mark & ~tmpl->mark_mask)
+		return -EINVAL;
+
+	pol = kmemdup(tmpl, sizeof(*pol), GFP_KERNEL);
+	if (!pol)
+		return -ENOMEM;
+
+	refcount_set(&pol->refcnt, 1);
+	write_pnet(&pol->net, net);
+	pol->sched[MPTCP_SCHED_NAME_MAX - 1] = '\0';
+	mptcp_policy_mask(pol->family, &tmpl->daddr, pol->plen, &pol->daddr);
+
+	mutex_lock(&mptcp_policy_mutex);
+	old = mptcp_policy_find_id(net, pol->id);
+	if (old)
+		mptcp_policy_unlink(old);
+
+	hlist_add_head_rcu(&pol->node,
+			   mptcp_policy_bucket(net, pol->family, pol->plen,
+					       &pol->daddr));
+	mptcp_policy_count(pol, 1);
+	mutex_unlock(&mptcp_policy_mutex);
+
+	return 0;
+}
+EXPORT_SYMBOL(mptcp_policy_add);
+
+int mptcp_policy_del(struct net *net, u32 id)
+{
+	struct mptcp_policy *pol;
+	int ret = -ENOENT;
+
+	mutex_lock(&mptcp_policy_mutex);
+	pol = mptcp_policy_find_id(net, id);
+	if (pol) {
+		mptcp_policy_unlink(pol);
+		ret = 0;
+	}
+	mutex_unlock(&mptcp_policy_mutex);
+
+	return ret;
+}
+EXPORT_SYMBOL(mptcp_policy_del);
+
+void mptcp_policy_flush(struct net *net)
+{
+	int i;
+
+	mutex_lock(&mptcp_policy_mutex);
+	for (i = 0; i < ARRAY_SIZE(mptcp_policy_hash); i++) {
+		struct mptcp_policy *pol;
+		struct hlist_node *tmp;
+
+		hlist_for_each_entry_safe(pol, tmp, &mptcp_policy_hash[i], node) {
+			if (net_eq(read_pnet(&pol->net), net))
+				mptcp_policy_unlink(pol);
+		}
+	}
+	mutex_unlock(&mptcp_policy_mutex);
+}
+EXPORT_SYMBOL(mptcp_policy_flush);
+
+/* Same as mptcp_metrics_dump(), for the rules of net */
+int mptcp_policy_dump(struct net *net, unsigned long *pos,
+		      int (*fill)(const struct mptcp_policy *pol, void *arg),
+		      void *arg)
+{
+	unsigned long idx = 0;
+	int i, ret = 0;
+
+	rcu_read_lock();
+	for (i = 0; i < ARRAY_SIZE(mptcp_policy_hash); i++) {
+		struct mptcp_policy *pol;
+
+		hlist_for_each_entry_rcu(pol, &mptcp_policy_hash[i], node) {
+			if (!net_eq(read_pnet(&pol->net), net))
+				continue;
+
+			if (idx++ < *pos)
+				continue;
+
+			ret = fill(pol, arg);
+			if (ret)
+				goto out;
+
+			(*pos)++;
+		}
+	}
+out:
+	rcu_read_unlock();
+
+	return ret;
+}
+EXPORT_SYMBOL(mptcp_policy_dump);
+
+static void __net_exit mptcp_policy_exit_net(struct net *net)
+{
+	mptcp_policy_flush(net);
+}
+
+static struct pernet_operations mptcp_policy_net_ops = {
+	.exit = mptcp_policy_exit_net,
+};
+
+int __init mptcp_policy_init(void)
+{
+	return register_pernet_subsys(&mptcp_policy_net_ops);
+}
+
+void mptcp_policy_undo(void)
+{
+	unregister_pernet_subsys(&mptcp_policy_net_ops);
+}
@@ -34,7 +34,7 @@ static bool mptcp_rr_is_available(const struct sock *sk, const struct sk_buff *s
 	/* We do not send data on this subflow unless it is
 	 * fully established, i.e. the 4th ack has been received.
 	 */
-	if (tp->mptcp->pre_established)
+	if (mptcp_sub_wait_fourth_ack(tp))
 		return false;
 
 	if (tp->pf)
@@ -0,0 +1,241 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ *	MPTCP implementation - Shared Bottleneck Detection
+ *
+ *	Groups the subflows of a connection into clusters that share a
+ *	bottleneck, following RFC 8382. The coupled congestion-controls only
+ *	couple the subflows within the same cluster, so that subflows on
+ *	disjoint paths behave like independent TCP-flows.
+ *
+ *	Instead of one-way delays, we use the RTT-samples of the subflows.
+ *	The sums over the last N intervals of RFC 8382 are approximated by
+ *	moving averages.
+ *
+ *	This program is free software; you can redistribute it and/or
+ *      modify it under the terms of the GNU General Public License
+ *      as published by the Free Software Foundation; either version
+ *      2 of the License, or (at your option) any later version.
+ */
+
+#include <net/mptcp.h>
+#include <net/tcp.h>
+
+/* Fixed-point representation of 1 for the estimates */
+#define MPTCP_SBD_ONE		1024
+
+/* Base interval T, in ms */
+#define MPTCP_SBD_INTERVAL	350
+/* The averages span about N = 2^5 and M = 2^3 intervals */
+#define MPTCP_SBD_N_SHIFT	5
+#define MPTCP_SBD_M_SHIFT	3
+/* Intervals needed before a subflow gets grouped */
+#define MPTCP_SBD_WARMUP	(1 << MPTCP_SBD_M_SHIFT)
+
+/* Parameters of RFC 8382, scaled by MPTCP_SBD_ONE */
+#define MPTCP_SBD_C_S		(-MPTCP_SBD_ONE / 100)	/* c_s = -0.01 */
+#define MPTCP_SBD_C_H		(MPTCP_SBD_ONE * 3 / 10)	/* c_h = 0.3 */
+#define MPTCP_SBD_P_V		(MPTCP_SBD_ONE * 7 / 10)	/* p_v = 0.7 */
+#define MPTCP_SBD_P_F		(MPTCP_SBD_ONE / 10)	/* p_f = 0.1 */
+#define MPTCP_SBD_P_MAD		(MPTCP_SBD_ONE / 10)	/* p_mad = 0.1 */
+#define MPTCP_SBD_P_S		(MPTCP_SBD_ONE * 15 / 100)	/* p_s = 0.15 */
+#define MPTCP_SBD_P_L		(MPTCP_SBD_ONE / 10)	/* p_l = 0.1 */
+#define MPTCP_SBD_P_D		(MPTCP_SBD_ONE / 10)	/* p_d = 0.1 */
+
+int sysctl_mptcp_sbd __read_mostly;
+EXPORT_SYMBOL(sysctl_mptcp_sbd);
+
+static u32 mptcp_sbd_ewma(u32 avg, u32 val, int shift)
+{
+	return avg - (avg >> shift) + (val >> shift);
+}
+
+static bool mptcp_sbd_ready(const struct mptcp_sbd *sbd)
+{
+	return sbd->intervals >= MPTCP_SBD_WARMUP;
+}
+
+/* Step 1 of the grouping - with the hysteresis of c_h */
+static bool mptcp_sbd_is_bottleneck(const struct mptcp_sbd *sbd)
+{
+	if (sbd->loss_est > MPTCP_SBD_P_L)
+		return true;
+
+	return sbd->skew_est < (sbd->bottleneck ? MPTCP_SBD_C_H : MPTCP_SBD_C_S);
+}
+
+static bool mptcp_sbd_rel_close(u32 a, u32 b, u32 p)
+{
+	u32 max = max(a, b);
+
+	return (u64)(max - min(a, b)) * MPTCP_SBD_ONE <= (u64)max * p;
+}
+
+/* Steps 2 to 5 of the grouping, against the first subflow of a cluster */
+static bool mptcp_sbd_same_group(const struct mptcp_sbd *a,
+				 const struct mptcp_sbd *b)
+{
+	if (abs((s32)a->freq_est - (s32)b->freq_est) > MPTCP_SBD_P_F)
+		return false;
+
+	if (!mptcp_sbd_rel_close(a->var_est, b->var_est, MPTCP_SBD_P_MAD))
+		return false;
+
+	if (abs(a->skew_est - b->skew_est) > MPTCP_SBD_P_S)
+		return false;
+
+	if ((a->loss_est > MPTCP_SBD_P_L || b->loss_est > MPTCP_SBD_P_L) &&
+	    !mptcp_sbd_rel_close(a->loss_est, b->loss_est, MPTCP_SBD_P_D))
+		return false;
+
+	return true;
+}
+
+/* Assigns the clusters. A bottlenecked subflow joins the first cluster whose
+ * representative matches, or starts a new one. The others get a cluster of
+ * their own. As long as a subflow is warming up, everything stays coupled
+ * in cluster 0.
+ */
+static void mptcp_sbd_regroup(struct mptcp_cb *mpcb)
+{
+	struct mptcp_tcp_sock *mptcp, *rep;
+
+	mptcp_for_each_sub(mpcb, mptcp) {
+		if (mptcp_sk_can_send(mptcp_to_sock(mptcp)) &&
+		    !mptcp_sbd_ready(&mptcp->sbd))
+			goto couple_all;
+	}
+
+	mptcp_for_each_sub(mpcb, mptcp) {
+		struct mptcp_sbd *sbd = &mptcp->sbd;
+
+		sbd->bottleneck = mptcp_sbd_is_bottleneck(sbd);
+		sbd->cluster = mptcp->path_index;
+
+		if (!sbd->bottleneck)
+			continue;
+
+		mptcp_for_each_sub(mpcb, rep) {
+			if (rep == mptcp)
+				break;
+
+			/* Only representatives, i.e., the first of a cluster */
+			if (!rep->sbd.bottleneck ||
+			    rep->sbd.cluster != rep->path_index)
+				continue;
+
+			if (mptcp_sbd_same_group(&rep->sbd, sbd)) {
+				sbd->cluster = rep->path_index;
+				break;
+			}
+		}
+	}
+
+	return;
+
+couple_all:
+	mptcp_for_each_sub(mpcb, mptcp)
+		mptcp->sbd.cluster = 0;
+}
+
+static void mptcp_sbd_end_interval(struct sock *sk, struct mptcp_sbd *sbd)
+{
+	const struct tcp_sock *tp = tcp_sk(sk);
+	u32 segs = tp->segs_out - sbd->segs_out;
+	u32 mean, var, loss = 0, cross = 0;
+	s32 skew;
+	s8 side = 0;
+
+	mean = div_u64(sbd->sum_rtt, sbd->cnt);
+	var = div_u64(sbd->sum_var, sbd->cnt);
+	skew = sbd->skew * MPTCP_SBD_ONE / (s32)sbd->cnt;
+	if (segs)
+		loss = min_t(u32, (tp->total_retrans - sbd->retrans) *
+				  MPTCP_SBD_ONE / segs, MPTCP_SBD_ONE);
+
+	if (!sbd->intervals) {
+		sbd->mean_delay = mean;
+		sbd->var_est = var;
+		sbd->skew_est = skew;
+		sbd->loss_est = loss;
+	} else {
+		u32 margin = (u64)sbd->var_est * MPTCP_SBD_P_V / MPTCP_SBD_ONE;
+
+		/* A significant crossing of mean_delay */
+		if (mean > sbd->mean_delay + margin)
+			side = 1;
+		else if (mean + margin < sbd->mean_delay)
+			side = -1;
+
+		if (side && sbd->last_side && side != sbd->last_side)
+			cross = MPTCP_SBD_ONE;
+		if (side)
+			sbd->last_side = side;
+
+		sbd->mean_delay = mptcp_sbd_ewma(sbd->mean_delay, mean,
+						 MPTCP_SBD_M_SHIFT);
+		sbd->var_est = mptcp_sbd_ewma(sbd->var_est, var,
+					      MPTCP_SBD_N_SHIFT);
+		sbd->skew_est = sbd->skew_est -
+				(sbd->skew_est >> MPTCP_SBD_N_SHIFT) +
+				(skew >> MPTCP_SBD_N_SHIFT);
+		sbd->freq_est = mptcp_sbd_ewma(sbd->freq_est, cross,
+					       MPTCP_SBD_N_SHIFT);
+		sbd->loss_est = mptcp_sbd_ewma(sbd->loss_est, loss,
+					       MPTCP_SBD_N_SHIFT);
+	}
+
+	if (sbd->intervals < MPTCP_SBD_WARMUP)
+		sbd->intervals++;
+}
+
+static void mptcp_sbd_start_interval(const struct sock *sk,
+				     struct mptcp_sbd *sbd)
+{
+	const struct tcp_sock *tp = tcp_sk(sk);
+
+	sbd->t_start = tcp_jiffies32;
+	sbd->sum_rtt = 0;
+	sbd->sum_var = 0;
+	sbd->cnt = 0;
+	sbd->skew = 0;
+	sbd->retrans = tp->total_retrans;
+	sbd->segs_out = tp->segs_out;
+}
+
+/* To be called by the coupled congestion-controls from their pkts_acked */
+void mptcp_sbd_pkts_acked(struct sock *sk, const struct ack_sample *sample)
+{
+	struct tcp_sock *tp = tcp_sk(sk);
+	struct mptcp_sbd *sbd;
+	u32 rtt;
+
+	if (!sysctl_mptcp_sbd || !mptcp(tp) || is_meta_sk(sk) ||
+	    sample->rtt_us < 0)
+		return;
+
+	sbd = &tp->mptcp->sbd;
+	rtt = sample->rtt_us;
+
+	if (!sbd->t_start)
+		mptcp_sbd_start_interval(sk, sbd);
+
+	sbd->sum_rtt += rtt;
+	sbd->cnt++;
+	if (sbd->intervals) {
+		sbd->sum_var += abs((s32)rtt - (s32)sbd->mean_delay);
+		if (rtt < sbd->mean_delay)
+			sbd->skew++;
+		else if (rtt > sbd->mean_delay)
+			sbd->skew--;
+	}
+
+	if (tcp_jiffies32 - sbd->t_start <
+	    msecs_to_jiffies(MPTCP_SBD_INTERVAL))
+		return;
+
+	mptcp_sbd_end_interval(sk, sbd);
+	mptcp_sbd_start_interval(sk, sbd);
+
+	mptcp_sbd_regroup(tp->mpcb);
+}
+EXPORT_SYMBOL_GPL(mptcp_sbd_pkts_acked);
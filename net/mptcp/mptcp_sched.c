@@ -27,7 +27,13 @@ bool mptcp_is_def_unavailable(struct sock *sk)
 	/* We do not send data on this subflow unless it is
 	 * fully established, i.e. the 4th ack has been received.
 	 */
-	if (tp->mptcp->pre_established)
+	if (mptcp_sub_wait_fourth_ack(tp))
+		return true;
+
+	/* With MPTCPv1, the first data must go on the master, because it
+	 * carries the MP_CAPABLE-option. This matters for early joins.
+	 */
+	if (tp->mpcb->send_mptcpv1_mpcapable && !is_master_tp(tp))
 		return true;
 
 	if (tp->pf)
@@ -265,6 +271,78 @@ struct sock *get_available_subflow(struct sock *meta_sk, struct sk_buff *skb,
 }
 EXPORT_SYMBOL_GPL(get_available_subflow);
 
+/* Opportunistic retransmissions may always use that many bytes, on top of
+ * the sysctl_mptcp_opti_budget percent of the bytes acked at the meta-level.
+ */
+#define MPTCP_OPTI_BUDGET_INIT	(64U * 1024U)
+
+/* Delivery-rate of a subflow, in bytes per second. Falls back to cwnd/srtt
+ * as long as there is no rate-sample yet.
+ */
+u64 mptcp_sub_rate(const struct tcp_sock *tp)
+{
+	u64 rate;
+
+	if (tp->rate_delivered && tp->rate_interval_us) {
+		rate = (u64)tp->rate_delivered * tp->mss_cache * USEC_PER_SEC;
+		do_div(rate, tp->rate_interval_us);
+	} else if (tp->srtt_us) {
+		rate = (u64)tp->snd_cwnd * tp->mss_cache * USEC_PER_SEC;
+		do_div(rate, max(tp->srtt_us >> 3, 1U));
+	} else {
+		rate = 0;
+	}
+
+	return rate;
+}
+
+/* Estimated time (in us) for a segment queued now on the subflow to reach
+ * the peer: half an RTT plus the time to drain what is not yet sent.
+ */
+static u64 mptcp_sub_delivery_us(const struct tcp_sock *tp)
+{
+	u64 rate = mptcp_sub_rate(tp);
+	u64 backlog;
+
+	if (!rate)
+		return U64_MAX;
+
+	backlog = (u64)(tp->write_seq - tp->snd_nxt) * USEC_PER_SEC;
+
+	return (tp->srtt_us >> 4) + div64_u64(backlog, rate);
+}
+
+/* How much of the peer's receive-window is taken by data sent beyond the
+ * head of the meta rtx-queue - and thus likely sitting in its ofo-queue,
+ * waiting for the head. Scaled to 1024.
+ */
+u32 mptcp_ofo_occupancy(const struct tcp_sock *meta_tp,
+			const struct sk_buff *skb_head)
+{
+	u32 beyond = meta_tp->snd_nxt - TCP_SKB_CB(skb_head)->end_seq;
+
+	if (!meta_tp->snd_wnd || !before(TCP_SKB_CB(skb_head)->end_seq,
+					  meta_tp->snd_nxt))
+		return 0;
+
+	return min_t(u64, div_u64((u64)beyond << 10, meta_tp->snd_wnd), 1024);
+}
+
+static bool mptcp_opti_budget_ok(const struct tcp_sock *meta_tp,
+				 unsigned int len)
+{
+	const struct mptcp_cb *mpcb = meta_tp->mpcb;
+	u64 budget;
+
+	if (!sysctl_mptcp_opti_budget)
+		return false;
+
+	budget = div_u64(meta_tp->bytes_acked * sysctl_mptcp_opti_budget, 100) +
+		 MPTCP_OPTI_BUDGET_INIT;
+
+	return mpcb->opti_retrans_bytes + len <= budget;
+}
+
 static struct sk_buff *mptcp_rcv_buf_optimization(struct sock *sk, int penal)
 {
 	struct sock *meta_sk;
@@ -272,6 +350,8 @@ static struct sk_buff *mptcp_rcv_buf_optimization(struct sock *sk, int penal)
 	struct mptcp_tcp_sock *mptcp;
 	struct sk_buff *skb_head;
 	struct defsched_priv *def_p = defsched_get_priv(tp);
+	u64 delivery_us;
+	u32 occupancy;
 
 	meta_sk = mptcp_meta_sk(sk);
 	skb_head = tcp_rtx_queue_head(meta_sk);
@@ -279,6 +359,9 @@ static struct sk_buff *mptcp_rcv_buf_optimization(struct sock *sk, int penal)
 	if (!skb_head)
 		return NULL;
 
+	delivery_us = mptcp_sub_delivery_us(tp);
+	occupancy = mptcp_ofo_occupancy(tcp_sk(meta_sk), skb_head);
+
 	/* If penalization is optional (coming from mptcp_next_segment() and
 	 * We are not send-buffer-limited we do not penalize. The retransmission
 	 * is just an optimization to fix the idle-time due to the delay before
@@ -291,13 +374,22 @@ static struct sk_buff *mptcp_rcv_buf_optimization(struct sock *sk, int penal)
 	if (tcp_jiffies32 - def_p->last_rbuf_opti < usecs_to_jiffies(tp->srtt_us >> 3))
 		goto retrans;
 
-	/* Half the cwnd of the slow flows */
+	/* As long as the head-of-line blocking does not take most of the
+	 * peer's window, the slow subflows are not what is holding us back.
+	 */
+	if (occupancy < 512)
+		goto retrans;
+
+	/* Half the cwnd of the flows that take at least twice as long as
+	 * this one to deliver.
+	 */
 	mptcp_for_each_sub(tp->mpcb, mptcp) {
 		struct tcp_sock *tp_it = mptcp->tp;
 
 		if (tp_it != tp &&
 		    TCP_SKB_CB(skb_head)->path_mask & mptcp_pi_to_flag(tp_it->mptcp->path_index)) {
-			if (tp->srtt_us < tp_it->srtt_us && inet_csk((struct sock *)tp_it)->icsk_ca_state == TCP_CA_Open) {
+			if (delivery_us < mptcp_sub_delivery_us(tp_it) / 2 &&
+			    inet_csk((struct sock *)tp_it)->icsk_ca_state == TCP_CA_Open) {
 				u32 prior_cwnd = tp_it->snd_cwnd;
 
 				tp_it->snd_cwnd = max(tp_it->snd_cwnd >> 1U, 1U);
@@ -307,6 +399,9 @@ static struct sk_buff *mptcp_rcv_buf_optimization(struct sock *sk, int penal)
 					tp_it->snd_ssthresh = max(tp_it->snd_ssthresh >> 1U, 2U);
 
 				def_p->last_rbuf_opti = tcp_jiffies32;
+
+				tp->mpcb->opti_penal++;
+				MPTCP_INC_STATS(sock_net(meta_sk), MPTCP_MIB_OPTIPENAL);
 			}
 		}
 	}
@@ -318,15 +413,23 @@ static struct sk_buff *mptcp_rcv_buf_optimization(struct sock *sk, int penal)
 		bool do_retrans = false;
 		mptcp_for_each_sub(tp->mpcb, mptcp) {
 			struct tcp_sock *tp_it = mptcp->tp;
+			u64 it_delivery_us;
 
 			if (tp_it != tp &&
 			    TCP_SKB_CB(skb_head)->path_mask & mptcp_pi_to_flag(tp_it->mptcp->path_index)) {
-				if (tp_it->snd_cwnd <= 4) {
+				/* Head is probably lost over there */
+				if (inet_csk((struct sock *)tp_it)->icsk_ca_state >= TCP_CA_Recovery) {
 					do_retrans = true;
 					break;
 				}
 
-				if (4 * tp->srtt_us >= tp_it->srtt_us) {
+				/* The fuller the peer's ofo-queue, the smaller
+				 * the gain needs to be: from twice as fast
+				 * down to simply faster.
+				 */
+				it_delivery_us = mptcp_sub_delivery_us(tp_it);
+				if (delivery_us == U64_MAX ||
+				    div_u64(delivery_us * (2048 - occupancy), 1024) >= it_delivery_us) {
 					do_retrans = false;
 					break;
 				} else {
@@ -335,7 +438,8 @@ static struct sk_buff *mptcp_rcv_buf_optimization(struct sock *sk, int penal)
 			}
 		}
 
-		if (do_retrans && mptcp_is_available(sk, skb_head, false)) {
+		if (do_retrans && mptcp_is_available(sk, skb_head, false) &&
+		    mptcp_opti_budget_ok(tcp_sk(meta_sk), skb_head->len)) {
 			trace_mptcp_retransmit(sk, skb_head);
 			return skb_head;
 		}
@@ -377,8 +481,7 @@ static struct sk_buff *__mptcp_next_segment(struct sock *meta_sk, int *reinject)
 			/* meta is send buffer limited */
 			tcp_chrono_start(meta_sk, TCP_CHRONO_SNDBUF_LIMITED);
 
-			subsk = mpcb->sched_ops->get_subflow(meta_sk,
-							     NULL, false);
+			subsk = mptcp_sched_get_subflow(meta_sk, NULL, false);
 			if (!subsk)
 				return NULL;
 
@@ -411,7 +514,7 @@ struct sk_buff *mptcp_next_segment(struct sock *meta_sk,
 	if (!skb)
 		return NULL;
 
-	*subsk = tcp_sk(meta_sk)->mpcb->sched_ops->get_subflow(meta_sk, skb, false);
+	*subsk = mptcp_sched_get_subflow(meta_sk, skb, false);
 	if (!*subsk)
 		return NULL;
 
@@ -618,6 +721,15 @@ void mptcp_init_scheduler(struct mptcp_cb *mpcb)
 		}
 	}
 
+	/* Or by the policy table - it got loaded when adding the rule */
+	if (mpcb->policy && mpcb->policy->sched[0]) {
+		sched = mptcp_sched_find(mpcb->policy->sched);
+		if (sched && try_module_get(sched->owner)) {
+			mpcb->sched_ops = sched;
+			goto out;
+		}
+	}
+
 	list_for_each_entry_rcu(sched, &mptcp_sched_list, list) {
 		if (try_module_get(sched->owner)) {
 			mpcb->sched_ops = sched;
@@ -628,6 +740,19 @@ void mptcp_init_scheduler(struct mptcp_cb *mpcb)
 	rcu_read_unlock();
 }
 
+/* Is the scheduler there, after trying to load it? */
+bool mptcp_sched_available(const char *name)
+{
+	bool ret;
+
+	rcu_read_lock();
+	ret = !!__mptcp_sched_find_autoload(name);
+	rcu_read_unlock();
+
+	return ret;
+}
+EXPORT_SYMBOL(mptcp_sched_available);
+
 /* Change scheduler for socket */
 int mptcp_set_scheduler(struct sock *sk, const char *name)
 {
@@ -108,6 +108,8 @@ static void mptcp_wvegas_pkts_acked(struct sock *sk,
 	if (sample->rtt_us < 0)
 		return;
 
+	mptcp_sbd_pkts_acked(sk, sample);
+
 	vrtt = sample->rtt_us + 1;
 
 	if (vrtt < wvegas->base_rtt)
@@ -154,6 +156,9 @@ static u64 mptcp_wvegas_weight(const struct mptcp_cb *mpcb, const struct sock *s
 		struct sock *sub_sk = mptcp_to_sock(mptcp);
 		struct wvegas *sub_wvegas = inet_csk_ca(sub_sk);
 
+		if (!mptcp_sbd_coupled(sk, sub_sk))
+			continue;
+
 		/* sampled_rtt is initialized by 0 */
 		if (mptcp_sk_can_send(sub_sk) && (sub_wvegas->sampled_rtt > 0))
 			total_rate += sub_wvegas->instant_rate;
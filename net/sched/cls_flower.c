@@ -62,6 +62,7 @@ struct fl_flow_key {
 		};
 	} tp_range;
 	struct flow_dissector_key_ct ct;
+	struct flow_dissector_key_mptcp mptcp;
 } __aligned(BITS_PER_LONG / 8); /* Ensure that we can do comparisons as longs. */
 
 struct fl_flow_mask_range {
@@ -691,6 +692,10 @@ static const struct nla_policy fl_policy[TCA_FLOWER_MAX + 1] = {
 	[TCA_FLOWER_KEY_CT_LABELS_MASK]	= { .type = NLA_BINARY,
 					    .len = 128 / BITS_PER_BYTE },
 	[TCA_FLOWER_FLAGS]		= { .type = NLA_U32 },
+	[TCA_FLOWER_KEY_MPTCP_SUBTYPE]	= { .type = NLA_U8 },
+	[TCA_FLOWER_KEY_MPTCP_SUBTYPE_MASK] = { .type = NLA_U8 },
+	[TCA_FLOWER_KEY_MPTCP_TOKEN]	= { .type = NLA_U32 },
+	[TCA_FLOWER_KEY_MPTCP_TOKEN_MASK] = { .type = NLA_U32 },
 };
 
 static const struct nla_policy
@@ -1049,6 +1054,26 @@ static int fl_set_key_ct(struct nlattr **tb,
 	return 0;
 }
 
+static void fl_set_key_mptcp(struct nlattr **tb,
+			     struct flow_dissector_key_mptcp *key,
+			     struct flow_dissector_key_mptcp *mask)
+{
+	if (!tb[TCA_FLOWER_KEY_MPTCP_SUBTYPE] &&
+	    !tb[TCA_FLOWER_KEY_MPTCP_TOKEN])
+		return;
+
+	fl_set_key_val(tb, &key->subtype, TCA_FLOWER_KEY_MPTCP_SUBTYPE,
+		       &mask->subtype, TCA_FLOWER_KEY_MPTCP_SUBTYPE_MASK,
+		       sizeof(key->subtype));
+	fl_set_key_val(tb, &key->token, TCA_FLOWER_KEY_MPTCP_TOKEN,
+		       &mask->token, TCA_FLOWER_KEY_MPTCP_TOKEN_MASK,
+		       sizeof(key->token));
+
+	/* Otherwise, a subtype of 0 would also match plain TCP */
+	key->flags = FLOW_DIS_MPTCP_OPTION;
+	mask->flags = FLOW_DIS_MPTCP_OPTION;
+}
+
 static int fl_set_key(struct net *net, struct nlattr **tb,
 		      struct fl_flow_key *key, struct fl_flow_key *mask,
 		      struct netlink_ext_ack *extack)
@@ -1140,6 +1165,7 @@ static int fl_set_key(struct net *net, struct nlattr **tb,
 		fl_set_key_val(tb, &key->tcp.flags, TCA_FLOWER_KEY_TCP_FLAGS,
 			       &mask->tcp.flags, TCA_FLOWER_KEY_TCP_FLAGS_MASK,
 			       sizeof(key->tcp.flags));
+		fl_set_key_mptcp(tb, &key->mptcp, &mask->mptcp);
 	} else if (key->basic.ip_proto == IPPROTO_UDP) {
 		fl_set_key_val(tb, &key->tp.src, TCA_FLOWER_KEY_UDP_SRC,
 			       &mask->tp.src, TCA_FLOWER_KEY_UDP_SRC_MASK,
@@ -1337,6 +1363,8 @@ static void fl_init_dissector(struct flow_dissector *dissector,
 			     FLOW_DISSECTOR_KEY_IP, ip);
 	FL_KEY_SET_IF_MASKED(mask, keys, cnt,
 			     FLOW_DISSECTOR_KEY_TCP, tcp);
+	FL_KEY_SET_IF_MASKED(mask, keys, cnt,
+			     FLOW_DISSECTOR_KEY_MPTCP, mptcp);
 	FL_KEY_SET_IF_MASKED(mask, keys, cnt,
 			     FLOW_DISSECTOR_KEY_ICMP, icmp);
 	FL_KEY_SET_IF_MASKED(mask, keys, cnt,
@@ -2311,7 +2339,15 @@ static int fl_dump_key(struct sk_buff *skb, struct net *net,
 			     sizeof(key->tp.dst)) ||
 	     fl_dump_key_val(skb, &key->tcp.flags, TCA_FLOWER_KEY_TCP_FLAGS,
 			     &mask->tcp.flags, TCA_FLOWER_KEY_TCP_FLAGS_MASK,
-			     sizeof(key->tcp.flags))))
+			     sizeof(key->tcp.flags)) ||
+	     fl_dump_key_val(skb, &key->mptcp.subtype,
+			     TCA_FLOWER_KEY_MPTCP_SUBTYPE,
+			     &mask->mptcp.subtype,
+			     TCA_FLOWER_KEY_MPTCP_SUBTYPE_MASK,
+			     sizeof(key->mptcp.subtype)) ||
+	     fl_dump_key_val(skb, &key->mptcp.token, TCA_FLOWER_KEY_MPTCP_TOKEN,
+			     &mask->mptcp.token, TCA_FLOWER_KEY_MPTCP_TOKEN_MASK,
+			     sizeof(key->mptcp.token))))
 		goto nla_put_failure;
 	else if (key->basic.ip_proto == IPPROTO_UDP &&
 		 (fl_dump_key_val(skb, &key->tp.src, TCA_FLOWER_KEY_UDP_SRC,
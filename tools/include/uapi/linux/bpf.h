@@ -3354,8 +3354,22 @@ struct bpf_sock_ops {
 	__u64 bytes_received;
 	__u64 bytes_acked;
 	__bpf_md_ptr(struct bpf_sock *, sk);
+	/* MPTCP context, all zero for plain TCP. The subflow ids are also
+	 * zero when sk is the meta-socket itself.
+	 */
+	__u32 mptcp_path_index;
+	__u32 mptcp_loc_id;
+	__u32 mptcp_rem_id;
+	__u32 mptcp_flags;	/* BPF_SOCK_OPS_MPTCP_F_* */
+	__bpf_md_ptr(struct bpf_sock *, meta_sk);
 };
 
+/* Definitions for mptcp_flags */
+#define BPF_SOCK_OPS_MPTCP_F_META	(1<<0)	/* sk is the meta-socket */
+#define BPF_SOCK_OPS_MPTCP_F_MASTER	(1<<1)	/* initial subflow */
+#define BPF_SOCK_OPS_MPTCP_F_LOW_PRIO	(1<<2)	/* backup subflow */
+#define BPF_SOCK_OPS_MPTCP_F_FULLY_ESTAB (1<<3)	/* fully established */
+
 /* Definitions for bpf_sock_ops_cb_flags */
 #define BPF_SOCK_OPS_RTO_CB_FLAG	(1<<0)
 #define BPF_SOCK_OPS_RETRANS_CB_FLAG	(1<<1)
@@ -3418,6 +3432,31 @@ enum {
 					 */
 	BPF_SOCK_OPS_RTT_CB,		/* Called on every RTT.
 					 */
+	BPF_SOCK_OPS_MPTCP_SUB_CREATED_CB,	/* Called when MPTCP creates a
+						 * new subflow, right before
+						 * its SYN is sent. sk is the
+						 * subflow.
+						 */
+	BPF_SOCK_OPS_MPTCP_SUB_ESTABLISHED_CB,	/* Called when an MPTCP
+						 * subflow becomes fully
+						 * established.
+						 */
+	BPF_SOCK_OPS_MPTCP_PRIO_CB,	/* Called when the priority of an
+					 * MPTCP subflow changes (MP_PRIO).
+					 * Arg1: new low_prio (backup) value
+					 * Arg2: 1 if set by the peer,
+					 *       0 if set locally
+					 */
+	BPF_SOCK_OPS_MPTCP_REINJECT_CB,	/* Called when the data of an MPTCP
+					 * subflow is reinjected on the
+					 * others.
+					 * Arg1: # segments reinjected
+					 * Arg2: whether they were cloned
+					 */
+	BPF_SOCK_OPS_MPTCP_FALLBACK_CB,	/* Called when an MPTCP connection
+					 * falls back to plain TCP on the
+					 * subflow sk.
+					 */
 };
 
 /* List of TCP states. There is a build check in net/ipv4/tcp.c to detect